@@ -5,7 +5,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <time.h> 
+#include <math.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <glad/glad.h>
 #include <GL/freeglut.h>
@@ -21,6 +30,14 @@
 #include <assimp/postprocess.h>
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#ifdef WITH_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
 #endif
 
 // --- Estruturas de dados ---
@@ -33,33 +50,156 @@ typedef struct {
 
 typedef struct {
     unsigned int id;
-    char* type;
-    char* path;
+    const char* type;
+    char* path; // pendente: pertence à malha; resolvido: pertence ao registro de texturas
 } Texture;
 
+// Layout compacto (--quantize): 20 bytes em vez de 32
+typedef struct {
+    vec3 position;
+    GLbyte normal[4];     // snorm8; o quarto byte é só alinhamento
+    GLshort texCoords[2]; // ponto fixo: uv * Mesh.texCoordScale
+} PackedVertex;
+
 typedef struct {
-    Vertex* vertices;
+    Vertex* vertices;             // layout completo (NULL depois de compactar)
+    PackedVertex* packedVertices; // layout compacto, ou NULL
     unsigned int numVertices;
+    float texCoordScale;
 
-    unsigned int* indices;
+    void* indices;                // uint16 se numVertices <= 65536, senão uint32
+    GLenum indexType;             // GL_UNSIGNED_SHORT ou GL_UNSIGNED_INT
     unsigned int numIndices;
 
     Texture* textures;
     unsigned int numTextures;
     
     vec3 diffuseColor;
+
+    // Volumes envolventes no espaço do modelo (Mesh_ComputeBounds), para o culling
+    vec3 boundsMin;
+    vec3 boundsMax;
+    vec4 boundingSphere;          // centro xyz, raio w
+
+    // Cópias para o desenho (Mesh_PrepareForDraw); 0 = ainda não criada
+    GLuint vertexBuffer;
+    GLuint indexBuffer;
+    GLuint displayList;
+
+    int keepTexCoords;            // manda UV mesmo sem textura própria (primitivas em cache)
 } Mesh;
 
+// Fases medidas pelo perfil de carregamento (ver LoadProfile_*)
+typedef enum {
+    LOAD_PHASE_CACHE_READ,
+    LOAD_PHASE_IMPORT,
+    LOAD_PHASE_COUNT,
+    LOAD_PHASE_VERTEX_COPY,
+    LOAD_PHASE_INDEX_FLATTEN,
+    LOAD_PHASE_MATERIAL,
+    LOAD_PHASE_TEXTURE_DECODE,
+    LOAD_PHASE_GL_UPLOAD,
+    LOAD_PHASE_CACHE_WRITE,
+    LOAD_PHASE_MERGE,
+    LOAD_PHASE_QUANTIZE,
+    LOAD_PHASE_OBJ_PARSE,
+    LOAD_PHASE_BUFFER_UPLOAD,
+    LOAD_PHASE_MAX
+} LoadPhase;
+
+typedef struct LoadProfile {
+    char name[256];
+    // Somas em ns; fases executadas no pool acumulam o tempo de todas as threads
+    _Atomic uint64_t phaseNs[LOAD_PHASE_MAX];
+    atomic_uint phaseCalls[LOAD_PHASE_MAX];
+    uint64_t wallNs; // Model_Create de ponta a ponta
+    struct LoadProfile* next;
+} LoadProfile;
+
+typedef enum { MODEL_LOADING, MODEL_READY, MODEL_FAILED } ModelLoadState;
+
+// Como Model_Draw envia a geometria (--render / tecla R)
+typedef enum { RENDER_IMMEDIATE, RENDER_DISPLAY_LIST, RENDER_VBO, RENDER_BACKEND_COUNT } RenderBackend;
+
+// Sala pré-renderizada num cubemap (--room-cubemap / tecla I); o nível escala a resolução
+typedef enum { ROOM_CUBEMAP_OFF, ROOM_CUBEMAP_LOW, ROOM_CUBEMAP_MEDIUM, ROOM_CUBEMAP_HIGH, ROOM_CUBEMAP_LEVELS } RoomCubemapQuality;
+
+// Geometria fixa do martelo e dos bonecos (ver Primitive_Draw)
+typedef enum { PRIMITIVE_SPHERE, PRIMITIVE_HANDLE, PRIMITIVE_TIP, PRIMITIVE_CUBE, PRIMITIVE_COUNT } PrimitiveKind;
+
+// Contadores do culling por frustum, zerados a cada quadro em renderScene
+typedef struct {
+    unsigned int meshesTested, meshesCulled;
+    unsigned int bonecosTested, bonecosCulled;
+    unsigned int meshesHidden;    // fora do PVS da direção atual (ver Pvs_VisibleSet)
+} CullStats;
+
+// Passadas da fila de desenho, na ordem em que são executadas (ver RenderQueue_Execute)
+typedef enum { RENDER_PASS_OPAQUE, RENDER_PASS_OVERLAY, RENDER_PASS_COUNT } RenderPass;
+
+// Trocas de estado do GL no quadro: pedidas à fila e as que de fato foram enviadas
+typedef struct {
+    unsigned int requested, issued;
+} StateStats;
+
+// Fontes do texto de tela (Helvetica 12 e 18 do GLUT), rasterizadas no atlas de glifos
+typedef enum { TEXT_FONT_SMALL, TEXT_FONT_LARGE, TEXT_FONT_COUNT } TextFont;
+
+// Painéis 2D com textura em cache (ver Overlay_Draw)
+typedef enum { OVERLAY_SCOREBOARD, OVERLAY_MENU, OVERLAY_SCORES, OVERLAY_FINAL, OVERLAY_COUNT } OverlayPanel;
+
+// Como os quadros são agendados (ver Frame_RequestRedraw)
+typedef enum { FRAME_ON_DEMAND, FRAME_CAPPED, FRAME_UNCAPPED, FRAME_MODE_COUNT } FrameMode;
+
+// Trechos de renderScene medidos pelo perfil de quadro (ver Profiler_Begin)
+typedef enum { PROFILE_UPDATE, PROFILE_ROOM, PROFILE_BONECOS, PROFILE_HAMMER, PROFILE_HUD, PROFILE_SWAP, PROFILE_SECTION_COUNT } ProfileSection;
+
 typedef struct {
-    Mesh* meshes;
+    Mesh* meshes;              // dentro de arena (ver ModelArena_Create)
     unsigned int numMeshes;
 
     char* directory;
 
-    Texture* textures_loaded;
-    unsigned int num_textures_loaded;
+    // Um único bloco com as malhas e toda a geometria delas; liberado com um free
+    unsigned char* arena;
+    size_t arenaBytes;
+
+    LoadProfile* profile;
+
+    // Carregamento progressivo: a thread de carga publica as malhas prontas na CPU e a
+    // thread do GL as finaliza (texturas) em Model_PumpStreaming. numMeshes conta só as
+    // malhas finalizadas, que são as que Model_Draw desenha.
+    char* path;
+    vec3 loadViewPos;          // câmera no início da carga: malhas à frente dela carregam antes
+    vec3 loadViewDir;
+    pthread_t loadThread;
+    int loadThreadRunning;
+    atomic_int cpuState;       // ModelLoadState do lado da thread de carga
+    atomic_uint meshesTotal;   // publicado depois do import/leitura do cache
+    atomic_uchar* meshDone;    // meshDone[i] != 0 quando meshes[i] está pronta na CPU (no arena)
+    int loadedFromCache;
+    ModelLoadState state;      // estado visto pela thread do GL
+    uint64_t loadStartNs;
 } Model;
 
+static inline unsigned int Mesh_IndexSize(GLenum indexType) {
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+// Menor tipo de índice que endereça numVertices vértices
+static inline GLenum Mesh_IndexTypeFor(unsigned int numVertices) {
+    return numVertices <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+static inline unsigned int Mesh_GetIndex(const Mesh* mesh, unsigned int i) {
+    return mesh->indexType == GL_UNSIGNED_SHORT ? ((const GLushort*)mesh->indices)[i] : ((const GLuint*)mesh->indices)[i];
+}
+
+static inline void Mesh_SetIndex(Mesh* mesh, unsigned int i, unsigned int value) {
+    if (mesh->indexType == GL_UNSIGNED_SHORT) ((GLushort*)mesh->indices)[i] = (GLushort)value;
+    else ((GLuint*)mesh->indices)[i] = value;
+}
+
 // --- Variáveis Globais ---
 int screen_width = 1920;
 int screen_height = 1080;
@@ -99,43 +239,10 @@ float hammerCurrentScale = 1.5f;
 GLuint headTextures[4]; // 4 texturas, uma para cada tipo de boneco
 int texturesLoaded = 0; // Flag para saber se texturas foram carregadas
 
-// Carrega textura de arquivo
+// Carrega textura de arquivo pelo registro global (compartilhada com os modelos)
+Texture TextureRegistry_Acquire(const char* path, const char* typeName, LoadProfile* profile);
 GLuint loadTexture(const char* filename) {
-    int width, height, channels;
-    unsigned char* data = stbi_load(filename, &width, &height, &channels, 0);
-    
-    if (!data) {
-    printf("Falha ao carregar textura: %s\n", filename);
-        return 0;
-    }
-    
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    
-    // parâmetros da textura
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    
-    // Ajusta alinhamento para imagens RGB (3 canais)
-    if (channels == 3) {
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    }
-    
-    // envia os dados
-    GLenum format = (channels == 4) ? GL_RGBA : GL_RGB;
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    
-    // restaura alinhamento
-    if (channels == 3) {
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-    }
-    
-    stbi_image_free(data);
-    printf("Textura carregada: %s (%dx%d, %d canais)\n", filename, width, height, channels);
-    return textureID;
+    return TextureRegistry_Acquire(filename, "texture_diffuse", NULL).id;
 }
 
 void initHeadTextures() {
@@ -189,6 +296,7 @@ int showScoresMenu = 0; // quando 1, exibe só a lista de pontuações no menu
 typedef struct { int score; char timeStr[32]; } MatchRecord;
 MatchRecord matchHistory[MATCH_HISTORY_MAX];
 int matchHistoryCount = 0;
+int matchHistoryVersion = 0; // muda a cada alteração do histórico (painel de pontuações)
 
 // Persiste histórico em scores.txt: "YYYY-MM-DD HH:MM:SS <score>"
 void saveMatchHistoryToFile() {
@@ -247,6 +355,7 @@ void addMatchRecord(int s) {
         matchHistory[MATCH_HISTORY_MAX-1].timeStr[sizeof(matchHistory[MATCH_HISTORY_MAX-1].timeStr)-1]='\0';
         matchHistory[MATCH_HISTORY_MAX-1].score = s;
     }
+    matchHistoryVersion++;
     saveMatchHistoryToFile();
     printf("Placar registrado: %d (registros=%d)\n", s, matchHistoryCount);
 }
@@ -259,6 +368,69 @@ float slotOffsetZ = 0.0f;
 void Model_Draw(Model* model);
 Model* Model_Create(const char* path);
 void Model_Destroy(Model* model);
+extern RenderBackend renderBackend;
+const char* RenderBackend_Name(RenderBackend backend);
+RenderBackend RenderBackend_Effective(void);
+void Model_Submit(Model* model, mat4 view, vec4* planes, const unsigned char* visibleMeshes);
+void Model_LocalBounds(const Model* model, vec3 boxMin, vec3 boxMax);
+extern int pvsEnabled;
+void Pvs_Update(const Model* model, int windowWidth, int windowHeight);
+const unsigned char* Pvs_VisibleSet(const vec3 front);
+int Pvs_Progress(unsigned int* ready, unsigned int* total);
+void Pvs_Shutdown(void);
+extern RoomCubemapQuality roomCubemapQuality;
+const char* RoomCubemap_QualityName(RoomCubemapQuality quality);
+int RoomCubemap_Update(Model* model, int screenHeight);
+void RoomCubemap_Draw(mat4 projection, mat4 view);
+int RoomCubemap_FaceSize(void);
+void RoomCubemap_Shutdown(void);
+void applySceneLighting(void);
+extern int primitiveDetail;
+void Primitive_Draw(PrimitiveKind kind);
+Mesh* Primitive_Mesh(PrimitiveKind kind);
+void Primitive_Shutdown(void);
+extern int renderQueueEnabled;
+extern StateStats stateStats;
+void RenderQueue_BeginFrame(void);
+void RenderQueue_Submit(RenderPass pass, Mesh* mesh, mat4 modelView, GLuint texture, const float* color, GLboolean lit);
+void RenderQueue_Execute(RenderPass pass);
+void RenderQueue_Shutdown(void);
+void Text_Init(void);
+void Text_Draw(TextFont font, int x, int y, const float* color, const char* str);
+void Text_Flush(void);
+void Text_Shutdown(void);
+void Overlay_Draw(OverlayPanel panel, const int* inputs, int numInputs);
+void Overlay_Shutdown(void);
+int scoresPageCount(void);
+extern FrameMode frameMode;
+extern int frameRateCap;
+const char* Frame_ModeName(FrameMode mode);
+int Frame_ParseMode(const char* name, FrameMode* out);
+float Frame_Rate(void);
+void Frame_RequestRedraw(void);
+void Frame_RequestRedrawIn(unsigned int ms);
+void Frame_Begin(void);
+void Frame_End(void);
+void Frame_CycleMode(void);
+extern int profilerVisible;
+void Profiler_BeginFrame(void);
+void Profiler_EndFrame(void);
+void Profiler_Begin(ProfileSection section);
+void Profiler_End(ProfileSection section);
+void Profiler_Draw(void);
+void Profiler_DumpCsv(void);
+void Profiler_Shutdown(void);
+#define HEADLESS_DEFAULT_FRAMES 300
+extern int headlessFrames;
+int Headless_Run(const char* roomModelPath, int frames);
+extern int bonecoInstancing;
+const char* Bonecos_PathName(void);
+void Bonecos_Shutdown(void);
+
+// Culling por frustum: planos do quadro atual no espaço do mundo (ver renderScene)
+int frustumCulling = 1;  // tecla C alterna
+vec4 viewFrustum[6];
+CullStats cullStats;
 
 // Protótipos whack-a-mole
 void gameTick(int value);
@@ -267,8 +439,7 @@ void stopGame();
 void addSlot(float centerX, float topY, float centerZ);
 void addSlotWithType(float centerX, float topY, float centerZ, int type);
 void drawSlot(float x, float z);
-void drawBoneco(float x, float z);
-void drawBonecoAtIndex(unsigned int idx);
+void Bonecos_Draw(unsigned int first, unsigned int count);
 int loadSlotsFromFile(const char* path);
 
 // ---- Input (teclado) ----
@@ -283,7 +454,7 @@ void keyboardDown(unsigned char key, int x, int y) {
     if (showScoresMenu) {
         if (key == '\r' || key == '\n' || key == 27 || key == 'm' || key == 'M') {
             showScoresMenu = 0;
-            glutPostRedisplay();
+            Frame_RequestRedraw();
             return;
         }
         // Navegação por teclado no modal: 't' avança página, 'T' volta
@@ -291,8 +462,8 @@ void keyboardDown(unsigned char key, int x, int y) {
             int total = matchHistoryCount;
             int pages = (total + recordsPerPage - 1) / recordsPerPage;
             if (pages <= 0) pages = 1;
-            if (key == 't' && historyPage < pages - 1) { historyPage++; glutPostRedisplay(); }
-            else if (key == 'T' && historyPage > 0) { historyPage--; glutPostRedisplay(); }
+            if (key == 't' && historyPage < pages - 1) { historyPage++; Frame_RequestRedraw(); }
+            else if (key == 'T' && historyPage > 0) { historyPage--; Frame_RequestRedraw(); }
             return;
         }
     }
@@ -316,6 +487,7 @@ void keyboardDown(unsigned char key, int x, int y) {
             isPaused = 1;
             gameActive = 0; // desativa o modo jogo mas mantém estado pausado
             printf("Jogo pausado (restam %u ms)\n", pausedRemainingMs);
+            Frame_RequestRedraw();
         } else if (!gameActive && isPaused) {
             // Resume
             startGame();
@@ -324,10 +496,36 @@ void keyboardDown(unsigned char key, int x, int y) {
     } else if (key == 'v' || key == 'V') {
         drawCubeMode = !drawCubeMode;
         printf("Modo visual: %s\n", drawCubeMode ? "Bonecos 3D" : "Quadrados verdes");
-        glutPostRedisplay();
+        Frame_RequestRedraw();
+    } else if (key == 'r' || key == 'R') {
+        // Alterna o backend de desenho dos modelos (imediato -> display list -> VBO)
+        renderBackend = (RenderBackend)((renderBackend + 1) % RENDER_BACKEND_COUNT);
+        printf("Render: %s\n", RenderBackend_Name(RenderBackend_Effective()));
+        Frame_RequestRedraw();
+    } else if (key == 'i' || key == 'I') {
+        // Sala como cubemap: desligado -> baixa -> média -> alta (cada troca remonta)
+        roomCubemapQuality = (RoomCubemapQuality)((roomCubemapQuality + 1) % ROOM_CUBEMAP_LEVELS);
+        printf("Sala em cubemap: %s\n", RoomCubemap_QualityName(roomCubemapQuality));
+        Frame_RequestRedraw();
+    } else if (key == 'q' || key == 'Q') {
+        renderQueueEnabled = !renderQueueEnabled;
+        printf("Fila de desenho: %s\n", renderQueueEnabled ? "ordenada, com cache de estado" : "ordem de envio, sem cache");
+        Frame_RequestRedraw();
+    } else if (key == 'f' || key == 'F') {
+        Frame_CycleMode();
+    } else if (key == 'g' || key == 'G') {
+        profilerVisible = !profilerVisible;
+        printf("Perfil de quadro: %s\n", profilerVisible ? "visível" : "oculto");
+        Frame_RequestRedraw();
+    } else if (key == 'h' || key == 'H') {
+        Profiler_DumpCsv();
+    } else if (key == 'c' || key == 'C') {
+        frustumCulling = !frustumCulling;
+        printf("Culling por frustum: %s\n", frustumCulling ? "ligado" : "desligado");
+        Frame_RequestRedraw();
     } else if (key == 'm' || key == 'M' || key == 27) { // 'm' or ESC to toggle menu
         if (inMenu) closeMenu(); else openMenu();
-        glutPostRedisplay();
+        Frame_RequestRedraw();
     } else if ((key == '\r' || key == '\n' || key == ' ') && inMenu) {
         // Enter/Space confirm selection in menu
         if (menuSelected == 0) {
@@ -355,14 +553,14 @@ void keyboardDown(unsigned char key, int x, int y) {
             // Sair do jogo
             exit(0);
         }
-        glutPostRedisplay();
+        Frame_RequestRedraw();
     }
     // Dismiss final modal with Enter
     if (showFinalModal && (key == '\r' || key == '\n')) {
         showFinalModal = 0;
         // finalize and return to menu
         stopGame();
-        glutPostRedisplay();
+        Frame_RequestRedraw();
     }
 }
 
@@ -380,7 +578,7 @@ void specialKeyDown(int key, int x, int y) {
         int pages = (total + recordsPerPage - 1) / recordsPerPage;
         if (historyPage < pages - 1) historyPage++;
     }
-    glutPostRedisplay();
+    Frame_RequestRedraw();
 }
 
 // Chamada quando uma tecla é solta
@@ -395,44 +593,31 @@ void processKeyboard(void) {
 
 
 
-// Função para desenhar o martelo com primitivas OpenGL
-void drawHammer() {
-    GLUquadric* quadric = gluNewQuadric();
-    
-    // Cor do cabo (madeira marrom)
-    glColor3f(0.55f, 0.27f, 0.07f);
-    
+// Martelo com primitivas em cache, enfileirado na passada sobreposta (sem depth test).
+// hammerMatrix: modelview com o cabo em (0,0,0).
+void drawHammer(mat4 hammerMatrix) {
+    static const float handleColor[3] = { 0.55f, 0.27f, 0.07f }; // madeira marrom
+    static const float headColor[3] = { 0.6f, 0.6f, 0.65f };     // metal cinza
+    static const float tipColor[3] = { 0.5f, 0.5f, 0.55f };
+    mat4 part;
+
     // CABO: Cilindro vertical (de baixo para cima)
-    glPushMatrix();
-    glRotatef(-90.0f, 1.0f, 0.0f, 0.0f); // Rotaciona para ficar vertical
-    gluCylinder(quadric, 0.15, 0.15, 2.5, 16, 1); // raio, raio_topo, altura, slices, stacks
-    glPopMatrix();
-    
-    // Cor da cabeça (metal cinza)
-    glColor3f(0.6f, 0.6f, 0.65f);
-    
-    // CABEÇA DO MARTELO: Cubo/Paralelepípedo no topo
-    glPushMatrix();
-    glTranslatef(0.0f, 2.5f, 0.0f); // Move para o topo do cabo
-    
-    // Desenha um cubo achatado (cabeça do martelo)
-    glPushMatrix();
-    glScalef(0.8f, 0.4f, 0.4f); // Largura, altura, profundidade
-    glutSolidCube(1.0);
-    glPopMatrix();
+    glm_mat4_copy(hammerMatrix, part);
+    glm_rotate_x(part, glm_rad(-90.0f), part); // Rotaciona para ficar vertical
+    RenderQueue_Submit(RENDER_PASS_OVERLAY, Primitive_Mesh(PRIMITIVE_HANDLE), part, 0, handleColor, GL_TRUE); // raio 0.15, altura 2.5
     
-    glPopMatrix();
+    // CABEÇA DO MARTELO: cubo achatado no topo do cabo
+    glm_mat4_copy(hammerMatrix, part);
+    glm_translate(part, (vec3){ 0.0f, 2.5f, 0.0f });  // Move para o topo do cabo
+    glm_scale(part, (vec3){ 0.8f, 0.4f, 0.4f });      // Largura, altura, profundidade
+    RenderQueue_Submit(RENDER_PASS_OVERLAY, Primitive_Mesh(PRIMITIVE_CUBE), part, 0, headColor, GL_TRUE);
     
     // PONTA DE IMPACTO: Pequeno cilindro na ponta da cabeça
-    glColor3f(0.5f, 0.5f, 0.55f);
-    glPushMatrix();
-    glTranslatef(0.0f, 2.5f, 0.0f);
-    glRotatef(90.0f, 0.0f, 1.0f, 0.0f); // Rotaciona para apontar para frente
-    glTranslatef(0.0f, 0.0f, -0.4f);
-    gluCylinder(quadric, 0.15, 0.18, 0.3, 16, 1); // Ponta levemente cônica
-    glPopMatrix();
-    
-    gluDeleteQuadric(quadric);
+    glm_mat4_copy(hammerMatrix, part);
+    glm_translate(part, (vec3){ 0.0f, 2.5f, 0.0f });
+    glm_rotate_y(part, glm_rad(90.0f), part);         // Rotaciona para apontar para frente
+    glm_translate(part, (vec3){ 0.0f, 0.0f, -0.4f });
+    RenderQueue_Submit(RENDER_PASS_OVERLAY, Primitive_Mesh(PRIMITIVE_TIP), part, 0, tipColor, GL_TRUE); // Ponta levemente cônica
 }
 
 // ---- Implementação Whack-a-Mole ----
@@ -465,7 +650,7 @@ void gameTick(int value) {
         
         glutTimerFunc(moleShowMs, gameTick, 0);
     }
-    glutPostRedisplay();
+    Frame_RequestRedraw();
 }
 
 void startGame() {
@@ -488,6 +673,7 @@ void startGame() {
     glutTimerFunc(moleIntervalMs, gameTick, 0);
     // Fecha menu ao iniciar
     inMenu = 0;
+    Frame_RequestRedraw();
 }
 
 void stopGame() {
@@ -501,7 +687,7 @@ void stopGame() {
     isPaused = 0;
     pausedRemainingMs = 0;
     inMenu = 1;
-    glutPostRedisplay();
+    Frame_RequestRedraw();
 }
 
 void openMenu() {
@@ -555,121 +741,6 @@ void drawSlot(float x, float z) {
     glPopAttrib();
 }
 
-void drawBoneco(float x, float z) {
-    // Salva coordenadas originais ANTES de aplicar offsets
-    float origX = x;
-    float origZ = z;
-    
-    float y = 0.01f;
-    for (unsigned int i = 0; i < numSlots; i++) {
-        if (fabsf(slots[i].pos[0] - origX) < 0.0001f && fabsf(slots[i].pos[2] - origZ) < 0.0001f) {
-            y = slots[i].pos[1];
-            break;
-        }
-    }
-    
-    float trunkWidth = 0.9f;
-    float trunkHeight = 1.4f;
-    float trunkDepth = 0.6f;
-    float headRadius = 1.40f; 
-    
-    x += slotOffsetX - 2.0f;  // Move todo o boneco 
-    z += slotOffsetZ;
-    
-    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
-    glDisable(GL_LIGHTING);
-    glDisable(GL_TEXTURE_2D);
-
-    // Busca o tipo do boneco 
-    int bonecoType = 0;
-    float trunkR = 0.8f, trunkG = 0.6f, trunkB = 0.3f;
-    for (unsigned int i = 0; i < numSlots; i++) {
-        if (fabsf(slots[i].pos[0] - origX) < 0.0001f && fabsf(slots[i].pos[2] - origZ) < 0.0001f) {
-            int t = slots[i].type % 4;
-            bonecoType = t;
-            if (t == 0) { trunkR = 0.0f; trunkG = 0.9f; trunkB = 0.0f; }
-            else if (t == 1) { trunkR = 0.0f; trunkG = 0.0f; trunkB = 0.9f; }
-            else if (t == 2) { trunkR = 0.9f; trunkG = 0.0f; trunkB = 0.0f; }
-            else { trunkR = 0.05f; trunkG = 0.05f; trunkB = 0.05f; }
-            break;
-        }
-    }
-    
-  
-    glPushMatrix();
-    // Centraliza cabeça com o tronco
-    float headX = x;
-    float headZ = z + 0.3f;  // Pequeno ajuste para frente
-    glTranslatef(headX, y + trunkHeight + headRadius, headZ);
-    
-    // === BILLBOARD: Faz a cabeça sempre olhar para a câmera ===
-    // Calcula vetor da cabeça para a câmera
-    vec3 headPos = {headX, y + trunkHeight + headRadius, headZ};
-    vec3 toCamera;
-    glm_vec3_sub(cameraPos, headPos, toCamera);
-    
-    // Billboard cilíndrico (só gira no eixo Y - mais natural para personagens)
-    // Ignora diferença de altura (Y) para rotação horizontal apenas
-    float dx = toCamera[0];
-    float dz = toCamera[2];
-    
-    // Calcula ângulo corretamente: atan2(x, z) retorna ângulo do vetor (x,z)
-    // Precisamos inverter o sinal para rotação correta do OpenGL
-    float angleY = glm_deg(atan2f(dx, dz));
-    
-    // Aplica rotação Y para fazer a cabeça olhar para a câmera
-    glRotatef(angleY, 0.0f, 1.0f, 0.0f);
-    
-    if (texturesLoaded) {
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, headTextures[bonecoType]);
-        glColor3f(1.0f, 1.0f, 1.0f);
-        
-        // Rotações base para orientar textura (após billboard)
-        glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);  // Corrige orientação vertical
-        glRotatef(0.0f, 0.0f, 0.0f, 1.0f);     
-        
-        GLUquadric* quad = gluNewQuadric();
-        gluQuadricTexture(quad, GL_TRUE);
-        gluQuadricOrientation(quad, GLU_OUTSIDE);
-        gluSphere(quad, headRadius, 32, 32);
-        gluDeleteQuadric(quad);
-        
-        glDisable(GL_TEXTURE_2D);
-    } else {
-        glutSolidSphere(headRadius, 16, 16);
-    }
-    
-    glPopMatrix();
-    
-    // Desenha o tronco (MEN.obj ou cubo se não carregado)
-    glPushMatrix();
-    glTranslatef(x, y - trunkHeight * 0.7f, z); // Posiciona o tronco entre o chão e a cabeça
-    glColor3f(trunkR, trunkG, trunkB);
-    
-    if (menModel != NULL) {
-        glEnable(GL_LIGHTING);
-        glRotatef(90.0f, 0.0f, 1.0f, 0.0f); // Rotação de 90° no eixo Y
-        glScalef(2.0f, 2.0f, 2.0f); // Escala 2x
-        Model_Draw(menModel);
-        glDisable(GL_LIGHTING);
-    } else {
-        // Fallback: desenha cubo se MEN.obj não carregar
-        glScalef(trunkWidth, trunkHeight, trunkDepth);
-        glutSolidCube(1.0f);
-    }
-    glPopMatrix();
-    
-    glPopAttrib();
-}
-
-void drawBonecoAtIndex(unsigned int idx) {
-    if (idx >= numSlots) return;
-    float x = slots[idx].pos[0];
-    float z = slots[idx].pos[2];
-    drawBoneco(x, z);
-}
-
 int loadSlotsFromFile(const char* path) {
     FILE* f = fopen(path, "r");
     if (!f) return 0;
@@ -720,10 +791,28 @@ void cleanup(void);
 Model* Model_Create(const char* path);
 void Model_Destroy(Model* model);
 void Model_Draw(Model* model);
-Mesh processMesh(struct aiMesh* mesh, const struct aiScene* scene, Model* model);
+void processMesh(struct aiMesh* mesh, const struct aiScene* scene, const char* directory, Mesh* outMesh, LoadProfile* profile);
 void processNode(struct aiNode* node, const struct aiScene* scene, Model* model);
-unsigned int TextureFromFile(const char* path, const char* directory);
-void loadMaterialTextures(struct aiMaterial* mat, enum aiTextureType type, const char* typeName, Mesh* outMesh, Model* model);
+// Protótipos do perfil de carregamento e do pool de threads
+int LoadProfile_DumpJson(const char* path);
+extern const char* loadProfileJsonPath;
+extern int mergeMeshesByMaterial;
+extern int quantizeVertices;
+void JobPool_Init(int numThreads);
+void JobPool_Shutdown(void);
+void TextureLoader_PumpUploads(void);
+int TextureLoader_Pending(void);
+unsigned int TextureLoader_Generation(void);
+extern int textureMipmaps;
+extern int textureCompression;
+extern int textureCacheEnabled;
+void TextureRegistry_PrintStats(void);
+extern int nativeObjLoader;
+int ObjLoader_Benchmark(void);
+Model* Model_CreateAsync(const char* path);
+ModelLoadState Model_PumpStreaming(Model* model);
+uint64_t Clock_NowNs(void);
+int RenderBackend_Parse(const char* name, RenderBackend* out);
 // Protótipos do menu
 void openMenu(void);
 void closeMenu(void);
@@ -731,26 +820,36 @@ void specialKeyDown(int key, int x, int y);
 
 
 // ---- Função principal ----
-int main(int argc, char** argv) {
-    if (argc < 2) {
-        fprintf(stderr, "Uso: %s <caminho_para_o_modelo.obj>\n", argv[0]);
-        return -1;
-    }
+void printUsage(const char* program) {
+    fprintf(stderr, "Uso: %s [opções] <caminho_para_o_modelo.obj>\n", program);
+    fprintf(stderr, "Opções:\n");
+    fprintf(stderr, "  --load-profile <arquivo.json>  grava o perfil de carregamento dos modelos ao sair\n");
+    fprintf(stderr, "  --merge-meshes                 junta as malhas de mesmo material (um desenho por material)\n");
+    fprintf(stderr, "  --quantize                     vértices compactos: normais snorm8 e UVs de 16 bits\n");
+    fprintf(stderr, "  --blocking-load                carrega os modelos antes de abrir a cena (sem streaming)\n");
+    fprintf(stderr, "  --assimp-obj                   lê .obj pelo assimp em vez do leitor nativo\n");
+    fprintf(stderr, "  --bench-obj                    compara o leitor nativo de OBJ com o assimp e sai\n");
+    fprintf(stderr, "  --render=immediate|list|vbo    como os modelos são desenhados (padrão: vbo; tecla R alterna)\n");
+    fprintf(stderr, "  --no-pvs                       não monta/usa o conjunto visível por direção da câmera\n");
+    fprintf(stderr, "  --room-cubemap[=low|medium|high]  desenha a sala de um cubemap pré-renderizado (tecla I alterna)\n");
+    fprintf(stderr, "  --no-instancing                desenha os bonecos em lote pelo pipeline fixo, sem instâncias\n");
+    fprintf(stderr, "  --no-mipmaps                   texturas só com o nível 0 e filtro bilinear (sem mipmaps)\n");
+    fprintf(stderr, "  --compress-textures            guarda as texturas RGB/RGBA em S3TC (DXT1/DXT5), se o driver tiver\n");
+    fprintf(stderr, "  --texture-cache                grava/usa <imagem>.texcache com os níveis já prontos\n");
+    fprintf(stderr, "  --primitive-detail=<n>         fatias da esfera das cabeças (padrão: 32; cilindros usam metade)\n");
+    fprintf(stderr, "  --frame-mode=on-demand|capped|uncapped  quando desenhar (padrão: on-demand; tecla F alterna)\n");
+    fprintf(stderr, "  --fps-cap=<n>                  limite de quadros por segundo (padrão: 60)\n");
+    fprintf(stderr, "  --headless[=n]                 sem janela: desenha n quadros (padrão: 300) em um pbuffer EGL e imprime os tempos\n");
+}
 
-    // --- Inicialização do FreeGLUT ---
-    glutInit(&argc, argv);
-    glutInitContextVersion(2, 1);
-    glutInitContextProfile(GLUT_COMPATIBILITY_PROFILE);
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
-    glutInitWindowSize(screen_width, screen_height);
-    glutCreateWindow("Visualizador Legado - Acerte os Arruaceiros!");
+int blockingLoad = 0;       // 1 = carrega tudo antes do primeiro quadro
+int benchObj = 0;           // --bench-obj
+int headlessFrames = 0;     // --headless[=n]; 0 = janela do freeglut
+uint64_t processStartNs = 0;
 
-    // --- Inicialização do GLAD ---
-    if (!gladLoadGL()) {
-        fprintf(stderr, "Falha ao inicializar o GLAD\n");
-        return -1;
-    }
-    
+// Estado do GL, modelos, slots, texturas e histórico: o mesmo para a janela e o headless.
+// Chamada com o contexto GL já criado e o GLAD carregado.
+static int initGame(const char* roomModelPath) {
     printf("OpenGL versão: %s\n", glGetString(GL_VERSION));
 
     // OpenGL legacy config
@@ -761,20 +860,32 @@ int main(int argc, char** argv) {
     glShadeModel(GL_SMOOTH);
     
     stbi_set_flip_vertically_on_load(1);
+    JobPool_Init(0);
     
-    // carrega modelo da sala
-    ourModel = Model_Create(argv[1]);
-    if (!ourModel) {
-        fprintf(stderr, "Falha ao carregar o modelo da sala.\n");
-        return -1;
-    }
-    
-    // carrega MEN.obj
-    menModel = Model_Create("MEN.obj");
-    if (!menModel) {
-    fprintf(stderr, "Aviso: Falha ao carregar MEN.obj - usando cubos para troncos\n");
+    if (blockingLoad) {
+        // carrega modelo da sala
+        ourModel = Model_Create(roomModelPath);
+        if (!ourModel) {
+            fprintf(stderr, "Falha ao carregar o modelo da sala.\n");
+            return -1;
+        }
+
+        // carrega MEN.obj
+        menModel = Model_Create("MEN.obj");
+        if (!menModel) {
+        fprintf(stderr, "Aviso: Falha ao carregar MEN.obj - usando cubos para troncos\n");
+        } else {
+        printf("Modelo MEN.obj carregado com sucesso\n");
+        }
     } else {
-    printf("Modelo MEN.obj carregado com sucesso\n");
+        // Streaming: a cena abre já e as malhas aparecem conforme ficam prontas
+        // (renderScene chama Model_PumpStreaming a cada quadro)
+        ourModel = Model_CreateAsync(roomModelPath);
+        menModel = Model_CreateAsync("MEN.obj");
+        if (!ourModel) {
+            fprintf(stderr, "Falha ao carregar o modelo da sala.\n");
+            return -1;
+        }
     }
 
     // martelo: primitiva GL
@@ -794,9 +905,109 @@ int main(int argc, char** argv) {
     }
     
     initHeadTextures();
+    TextureRegistry_PrintStats();
+    Text_Init();
     // carrega histórico
     loadMatchHistoryFromFile();
     printf("Histórico carregado: %d registros\n", matchHistoryCount);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    processStartNs = Clock_NowNs();
+    const char* roomModelPath = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--load-profile") == 0 && i + 1 < argc) loadProfileJsonPath = argv[++i];
+        else if (strcmp(argv[i], "--merge-meshes") == 0) mergeMeshesByMaterial = 1;
+        else if (strcmp(argv[i], "--quantize") == 0) quantizeVertices = 1;
+        else if (strcmp(argv[i], "--blocking-load") == 0) blockingLoad = 1;
+        else if (strcmp(argv[i], "--assimp-obj") == 0) nativeObjLoader = 0;
+        else if (strcmp(argv[i], "--bench-obj") == 0) benchObj = 1;
+        else if (strcmp(argv[i], "--no-pvs") == 0) pvsEnabled = 0;
+        else if (strcmp(argv[i], "--no-instancing") == 0) bonecoInstancing = 0;
+        else if (strcmp(argv[i], "--no-mipmaps") == 0) textureMipmaps = 0;
+        else if (strcmp(argv[i], "--compress-textures") == 0) textureCompression = 1;
+        else if (strcmp(argv[i], "--texture-cache") == 0) textureCacheEnabled = 1;
+        else if (strcmp(argv[i], "--room-cubemap") == 0) roomCubemapQuality = ROOM_CUBEMAP_MEDIUM;
+        else if (strncmp(argv[i], "--room-cubemap=", 15) == 0) {
+            if (strcmp(argv[i] + 15, "low") == 0) roomCubemapQuality = ROOM_CUBEMAP_LOW;
+            else if (strcmp(argv[i] + 15, "medium") == 0) roomCubemapQuality = ROOM_CUBEMAP_MEDIUM;
+            else if (strcmp(argv[i] + 15, "high") == 0) roomCubemapQuality = ROOM_CUBEMAP_HIGH;
+            else {
+                fprintf(stderr, "Qualidade de cubemap desconhecida: %s (use low, medium ou high)\n", argv[i] + 15);
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--primitive-detail=", 19) == 0) {
+            primitiveDetail = atoi(argv[i] + 19);
+            if (primitiveDetail < 4 || primitiveDetail > 128) {
+                fprintf(stderr, "Detalhe de primitiva inválido: %s (use de 4 a 128)\n", argv[i] + 19);
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--frame-mode=", 13) == 0) {
+            if (!Frame_ParseMode(argv[i] + 13, &frameMode)) {
+                fprintf(stderr, "Modo de quadros desconhecido: %s (use on-demand, capped ou uncapped)\n", argv[i] + 13);
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--fps-cap=", 10) == 0) {
+            frameRateCap = atoi(argv[i] + 10);
+            if (frameRateCap < 1 || frameRateCap > 1000) {
+                fprintf(stderr, "Limite de quadros inválido: %s (use de 1 a 1000)\n", argv[i] + 10);
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--headless") == 0) headlessFrames = HEADLESS_DEFAULT_FRAMES;
+        else if (strncmp(argv[i], "--headless=", 11) == 0) {
+            headlessFrames = atoi(argv[i] + 11);
+            if (headlessFrames < 1) {
+                fprintf(stderr, "Número de quadros inválido: %s\n", argv[i] + 11);
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--render=", 9) == 0) {
+            if (!RenderBackend_Parse(argv[i] + 9, &renderBackend)) {
+                fprintf(stderr, "Backend de desenho desconhecido: %s (use immediate, list ou vbo)\n", argv[i] + 9);
+                return -1;
+            }
+        }
+        else if (argv[i][0] != '-' && !roomModelPath) roomModelPath = argv[i];
+    }
+    if (benchObj) {
+        JobPool_Init(0);
+        int result = ObjLoader_Benchmark();
+        JobPool_Shutdown();
+        return result;
+    }
+    if (!roomModelPath) {
+        printUsage(argv[0]);
+        return -1;
+    }
+    if (headlessFrames) {
+#ifdef WITH_HEADLESS
+        return Headless_Run(roomModelPath, headlessFrames);
+#else
+        fprintf(stderr, "Modo headless indisponível: compile com -DWITH_HEADLESS (e -lEGL)\n");
+        return -1;
+#endif
+    }
+
+    // --- Inicialização do FreeGLUT ---
+    glutInit(&argc, argv);
+    glutInitContextVersion(2, 1);
+    glutInitContextProfile(GLUT_COMPATIBILITY_PROFILE);
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+    glutInitWindowSize(screen_width, screen_height);
+    glutCreateWindow("Visualizador Legado - Acerte os Arruaceiros!");
+
+    // --- Inicialização do GLAD ---
+    if (!gladLoadGL()) {
+        fprintf(stderr, "Falha ao inicializar o GLAD\n");
+        return -1;
+    }
+    
+    if (initGame(roomModelPath) != 0) return -1;
     
     // registra callbacks
     glutDisplayFunc(renderScene);
@@ -815,9 +1026,55 @@ int main(int argc, char** argv) {
 }
 
 // ---- Callbacks (GLUT) ----
-void renderScene(void) {
-    processKeyboard();
+// Luz direcional da sala; chamada com a matriz de visão já carregada (posição no mundo)
+void applySceneLighting(void) {
+    GLfloat light_position[] = { 5.0f, 10.0f, 5.0f, 0.0f };
+    GLfloat light_ambient[] = { 0.5f, 0.5f, 0.5f, 1.0f };
+    GLfloat light_diffuse[] = { 1.0f, 1.0f, 0.9f, 1.0f };
+    glLightfv(GL_LIGHT0, GL_POSITION, light_position);
+    glLightfv(GL_LIGHT0, GL_AMBIENT, light_ambient);
+    glLightfv(GL_LIGHT0, GL_DIFFUSE, light_diffuse);
+}
+
+// Finaliza as malhas que chegaram da thread de carga e trata falhas do streaming
+static void pumpModelStreaming(void) {
+    if (Model_PumpStreaming(ourModel) == MODEL_FAILED) {
+        fprintf(stderr, "Falha ao carregar o modelo da sala.\n");
+        exit(-1);
+    }
+    if (menModel && menModel->state == MODEL_LOADING) {
+        ModelLoadState state = Model_PumpStreaming(menModel);
+        if (state == MODEL_FAILED) {
+            fprintf(stderr, "Aviso: Falha ao carregar MEN.obj - usando cubos para troncos\n");
+            Model_Destroy(menModel);
+            menModel = NULL;
+        } else if (state == MODEL_READY) {
+            printf("Modelo MEN.obj carregado com sucesso\n");
+        }
+    }
+}
 
+// Simulação em passo fixo: martelo, virada da câmera e detecção de acerto avançam em passos de 1/60 s contados
+// pelo relógio monotônico, não por quadro: renderScene acumula o tempo real e roda
+// quantos passos couberem (no máximo SIMULATION_MAX_STEPS; o resto do atraso é
+// descartado). As velocidades abaixo são por passo, os mesmos valores que antes eram
+// por quadro a 60 Hz. O que é desenhado fica entre o penúltimo e o último passo,
+// interpolado pela fração do passo que sobrou no acumulador.
+
+#define SIMULATION_STEP_MS (1000.0 / 60.0)
+#define SIMULATION_MAX_STEPS 15   // ~250 ms de atraso recuperado por quadro
+
+static struct {
+    double lastMs;
+    double accumulatorMs;
+    int idle;                     // nada animando no último quadro
+    vec3 previousHammerPos;
+    float previousHammerAngle, previousHammerScale;
+    vec3 previousCameraFront;
+} simulation = { .idle = 1 };
+
+// Um passo da animação do martelo (com o teste de acerto no impacto) e da virada da câmera
+static void simulationStep(void) {
     // Atualiza animação do martelo
     float moveSpeed = 0.02f; // Velocidade de movimento
     float swingSpeed = 1.2f; // Velocidade de batida
@@ -925,22 +1182,57 @@ void renderScene(void) {
             hammerCurrentScale = hammerBaseScale * distanceFactor;
         }
     }
-    
+
+    // 2. Atualiza a mira da câmera se ela estiver virando
+    if (isCameraTurning) {
+        // Interpola suavemente a direção atual para a direção alvo
+        float interpolationSpeed = 0.08f; // Velocidade de virada mais controlada
+        
+        vec3 oldFront;
+        glm_vec3_copy(cameraFront, oldFront);
+        
+        glm_vec3_lerp(cameraFront, cameraTargetDirection, interpolationSpeed, cameraFront);
+        glm_vec3_normalize(cameraFront);
+
+        // Calcula o progresso da virada (0.0 = início, 1.0 = completo)
+        float distanceToTarget = glm_vec3_distance(cameraFront, cameraTargetDirection);
+        float initialDistance = glm_vec3_distance(oldFront, cameraTargetDirection);
+        if (initialDistance > 0.001f) {
+            cameraTurnProgress = 1.0f - (distanceToTarget / initialDistance);
+            if (cameraTurnProgress > 1.0f) cameraTurnProgress = 1.0f;
+            if (cameraTurnProgress < 0.0f) cameraTurnProgress = 0.0f;
+        }
+
+        // Atualiza os ângulos Yaw e Pitch a partir do novo vetor de direção
+        cameraPitch = glm_deg(asin(cameraFront[1]));
+        cameraYaw = glm_deg(atan2(cameraFront[2], cameraFront[0]));
+
+        // Para a virada quando estiver perto o suficiente do alvo
+        if (distanceToTarget < 0.05f) {
+            isCameraTurning = false;
+            cameraTurnProgress = 1.0f;
+        }
+    }
+}
+
+// Martelo em repouso segue a câmera (estilo FPS). Depende só da direção desenhada, então
+// roda a cada quadro, fora do passo fixo, e não é interpolado.
+static void hammerFollowCamera(vec3 front) {
     // Quando IDLE ou RETURNING perto do fim, martelo acompanha a câmera (estilo FPS)
     if (hammerState == IDLE || (hammerState == RETURNING && hammerAnimationMovingtoTarget < 0.1f)) {
         // Calcula posição do martelo relativa à câmera
         // Posiciona à direita e abaixo do centro da visão
         vec3 right, down, forward;
         
-        // Vetor para direita (perpendicular a cameraFront e cameraUp)
-        glm_vec3_cross(cameraFront, cameraUp, right);
+        // Vetor para direita (perpendicular a front e cameraUp)
+        glm_vec3_cross(front, cameraUp, right);
         glm_vec3_normalize(right);
         
         // Vetor para baixo (inverso do up)
         glm_vec3_negate_to(cameraUp, down);
         
         // Copia direção frontal
-        glm_vec3_copy(cameraFront, forward);
+        glm_vec3_copy(front, forward);
         
         // Posição base = câmera + um pouco à frente
         glm_vec3_copy(cameraPos, hammerPosCurrent);
@@ -959,42 +1251,84 @@ void renderScene(void) {
         glm_vec3_copy(hammerPosCurrent, hammerPosStart);
         
         hammerCurrentScale = hammerBaseScale * 0.8f; // Menor quando em repouso
+        glm_vec3_copy(hammerPosCurrent, simulation.previousHammerPos);
+        simulation.previousHammerScale = hammerCurrentScale;
     }
+}
 
-    // 2. Atualiza a mira da câmera se ela estiver virando
-    if (isCameraTurning) {
-        // Interpola suavemente a direção atual para a direção alvo
-        float interpolationSpeed = 0.08f; // Velocidade de virada mais controlada
-        
-        vec3 oldFront;
-        glm_vec3_copy(cameraFront, oldFront);
-        
-        glm_vec3_lerp(cameraFront, cameraTargetDirection, interpolationSpeed, cameraFront);
-        glm_vec3_normalize(cameraFront);
+// Roda os passos devidos desde o último quadro; devolve a fração do próximo passo
+// (0..1) para interpolar. Depois de um período parado (sem animação, só esperando
+// entrada no modo sob demanda) o tempo acumulado é descartado, senão o primeiro quadro
+// depois de um clique pularia a animação.
+static float simulationAdvance(void) {
+    double now = Clock_NowNs() / 1e6;
+    if (simulation.idle || simulation.lastMs == 0.0) simulation.accumulatorMs = 0.0;
+    else simulation.accumulatorMs += now - simulation.lastMs;
+    simulation.lastMs = now;
+    if (simulation.accumulatorMs > SIMULATION_MAX_STEPS * SIMULATION_STEP_MS) {
+        simulation.accumulatorMs = SIMULATION_MAX_STEPS * SIMULATION_STEP_MS;
+    }
+    while (simulation.accumulatorMs >= SIMULATION_STEP_MS) {
+        glm_vec3_copy(hammerPosCurrent, simulation.previousHammerPos);
+        simulation.previousHammerAngle = hammerAnimationAngle;
+        simulation.previousHammerScale = hammerCurrentScale;
+        glm_vec3_copy(cameraFront, simulation.previousCameraFront);
+        simulationStep();
+        simulation.accumulatorMs -= SIMULATION_STEP_MS;
+    }
+    simulation.idle = hammerState == IDLE && !isCameraTurning;
+    if (simulation.idle) {
+        // Nada a interpolar: o estado desenhado é o atual
+        glm_vec3_copy(hammerPosCurrent, simulation.previousHammerPos);
+        simulation.previousHammerAngle = hammerAnimationAngle;
+        simulation.previousHammerScale = hammerCurrentScale;
+        glm_vec3_copy(cameraFront, simulation.previousCameraFront);
+    }
+    return (float)(simulation.accumulatorMs / SIMULATION_STEP_MS);
+}
 
-        // Calcula o progresso da virada (0.0 = início, 1.0 = completo)
-        float distanceToTarget = glm_vec3_distance(cameraFront, cameraTargetDirection);
-        float initialDistance = glm_vec3_distance(oldFront, cameraTargetDirection);
-        if (initialDistance > 0.001f) {
-            cameraTurnProgress = 1.0f - (distanceToTarget / initialDistance);
-            if (cameraTurnProgress > 1.0f) cameraTurnProgress = 1.0f;
-            if (cameraTurnProgress < 0.0f) cameraTurnProgress = 0.0f;
-        }
+static int roomDrawnFromCubemap = 0; // último quadro desenhou a sala pelo cubemap
 
-        // Atualiza os ângulos Yaw e Pitch a partir do novo vetor de direção
-        cameraPitch = glm_deg(asin(cameraFront[1]));
-        cameraYaw = glm_deg(atan2(cameraFront[2], cameraFront[0]));
+// Algo na cena muda sozinho: martelo, virada da câmera, carga da sala/bonecos/texturas
+// ou montagem do PVS (pausada enquanto a sala vem do cubemap)
+static int sceneAnimating(void) {
+    if (hammerState != IDLE || isCameraTurning) return 1;
+    if (ourModel->state == MODEL_LOADING || (menModel && menModel->state == MODEL_LOADING)) return 1;
+    if (TextureLoader_Pending() > 0) return 1;
+    unsigned int pvsReady, pvsTotal;
+    return pvsEnabled && !roomDrawnFromCubemap && Pvs_Progress(&pvsReady, &pvsTotal) && pvsReady < pvsTotal;
+}
 
-        // Para a virada quando estiver perto o suficiente do alvo
-        if (distanceToTarget < 0.05f) {
-            isCameraTurning = false;
-            cameraTurnProgress = 1.0f;
-        }
+void renderScene(void) {
+    Frame_Begin();
+    Profiler_BeginFrame();
+    Profiler_Begin(PROFILE_UPDATE);
+    processKeyboard();
+    TextureLoader_PumpUploads();
+    pumpModelStreaming();
+
+    // Avança a simulação pelo relógio; alpha interpola entre os dois últimos passos
+    float alpha = simulationAdvance();
+
+    // Próximo quadro só enquanto algo se move ou carrega; o martelo em IDLE segue a
+    // câmera, que só muda com o mouse (mouseMove já pede o quadro)
+    if (sceneAnimating()) Frame_RequestRedraw();
+    Profiler_End(PROFILE_UPDATE);
+
+    // Cubemap da sala: monta (ou remonta após resize/troca de qualidade) antes do quadro
+    Profiler_Begin(PROFILE_ROOM);
+    int roomFromCubemap = 0;
+    if (roomCubemapQuality != ROOM_CUBEMAP_OFF && ourModel->state == MODEL_READY) {
+        roomFromCubemap = RoomCubemap_Update(ourModel, screen_height);
+        glViewport(0, 0, screen_width, screen_height);
+    }
+    roomDrawnFromCubemap = roomFromCubemap;
+    // Montagem progressiva do PVS da sala (usa seu próprio alvo; não mexe no quadro);
+    // com a sala vindo do cubemap ele não serve para nada
+    if (pvsEnabled && !roomFromCubemap && ourModel->state == MODEL_READY) {
+        Pvs_Update(ourModel, screen_width, screen_height);
+        glViewport(0, 0, screen_width, screen_height);
     }
-
-    // Força o redesenho continuamente para martelo acompanhar câmera
-    // (mesmo em IDLE, o martelo precisa seguir os movimentos da câmera)
-    glutPostRedisplay();
 
     glClearColor(0.2f, 0.3f, 0.5f, 1.0f); // Um azul céu
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -1010,105 +1344,125 @@ void renderScene(void) {
     // 2. LÓGICA DA CÂMERA EM PRIMEIRA PESSOA
     glMatrixMode(GL_MODELVIEW);
 
+    vec3 viewFront; // direção desenhada: a do mouse, ou a da virada interpolada entre passos
     if (!isCameraTurning) { // Só permite o controle livre do mouse se a câmera não estiver "mirando"
         vec3 front;
         front[0] = cos(glm_rad(cameraYaw)) * cos(glm_rad(cameraPitch));
         front[1] = sin(glm_rad(cameraPitch));
         front[2] = sin(glm_rad(cameraYaw)) * cos(glm_rad(cameraPitch));
         glm_vec3_normalize_to(front, cameraFront);
+        glm_vec3_copy(cameraFront, viewFront);
+    } else {
+        glm_vec3_lerp(simulation.previousCameraFront, cameraFront, alpha, viewFront);
+        glm_vec3_normalize(viewFront);
     }
+    hammerFollowCamera(viewFront);
     
     vec3 center;
-    glm_vec3_add(cameraPos, cameraFront, center);
+    glm_vec3_add(cameraPos, viewFront, center);
     glm_lookat(cameraPos, center, cameraUp, view);
     glLoadMatrixf((const GLfloat*)view);
 
+    // Planos do frustum no espaço do mundo, para descartar malhas e bonecos fora da tela
+    mat4 viewProjection;
+    glm_mat4_mul(projection, view, viewProjection);
+    glm_frustum_planes(viewProjection, viewFrustum);
+    memset(&cullStats, 0, sizeof(cullStats));
+    RenderQueue_BeginFrame();
+
     // --- Configuração da Luz (sem alterações) ---
-    GLfloat light_position[] = { 5.0f, 10.0f, 5.0f, 0.0f };
-    GLfloat light_ambient[] = { 0.5f, 0.5f, 0.5f, 1.0f };
-    GLfloat light_diffuse[] = { 1.0f, 1.0f, 0.9f, 1.0f };
-    glLightfv(GL_LIGHT0, GL_POSITION, light_position);
-    glLightfv(GL_LIGHT0, GL_AMBIENT, light_ambient);
-    glLightfv(GL_LIGHT0, GL_DIFFUSE, light_diffuse);
+    applySceneLighting();
     
     // --- Transformações do Modelo (sem alterações) ---
     glScalef(1.0f, 1.0f, 1.0f);
 
     // --- Desenha o Modelo ---
-    Model_Draw(ourModel);
+    // A sala é desenhada sem transformação: o espaço dela é o do mundo. O PVS (quando
+    // pronto para a direção atual) já corta o que as paredes escondem.
+    // No modo cubemap a sala é uma só passada que também grava a profundidade.
+    if (roomFromCubemap) {
+        RoomCubemap_Draw(projection, view);
+    } else {
+        const unsigned char* visibleMeshes = pvsEnabled ? Pvs_VisibleSet(viewFront) : NULL;
+        Model_Submit(ourModel, view, frustumCulling ? viewFrustum : NULL, visibleMeshes);
+        RenderQueue_Execute(RENDER_PASS_OPAQUE);
+    }
+    Profiler_End(PROFILE_ROOM);
 
     // --- Desenha os Bonecos (Whack-a-Mole) ---
+    Profiler_Begin(PROFILE_BONECOS);
     if (gameActive) {
         // Modo jogo: desenha apenas o boneco ativo
         if (currentActive >= 0 && (unsigned int)currentActive < numSlots && moleVisible) {
-            if (drawCubeMode) drawBonecoAtIndex(currentActive);
+            if (drawCubeMode) Bonecos_Draw(currentActive, 1);
             else drawSlot(slots[currentActive].pos[0], slots[currentActive].pos[2]);
         }
     } else {
-        // Modo livre: desenha todos os bonecos
-        for (unsigned int i = 0; i < numSlots; i++) {
-            if (drawCubeMode) drawBonecoAtIndex(i);
-            else drawSlot(slots[i].pos[0], slots[i].pos[2]);
+        // Modo livre: desenha todos os bonecos (em lote; ver Bonecos_Draw)
+        if (drawCubeMode) Bonecos_Draw(0, numSlots);
+        else {
+            for (unsigned int i = 0; i < numSlots; i++) drawSlot(slots[i].pos[0], slots[i].pos[2]);
         }
     }
+    Profiler_End(PROFILE_BONECOS);
 
     // --- Desenha o Martelo com Primitivas OpenGL no Espaço 3D ---
-    glDisable(GL_DEPTH_TEST);
-    
-    glPushMatrix(); // Salva a matriz atual
+    // Vai para a passada sobreposta da fila: sem depth test, por cima de tudo
+    Profiler_Begin(PROFILE_HAMMER);
+    mat4 hammerMatrix;
+    glm_mat4_copy(view, hammerMatrix);
+
+    // Posição, escala e ângulo entre os dois últimos passos da simulação
+    vec3 hammerPosDrawn;
+    glm_vec3_lerp(simulation.previousHammerPos, hammerPosCurrent, alpha, hammerPosDrawn);
+    float hammerScaleDrawn = glm_lerp(simulation.previousHammerScale, hammerCurrentScale, alpha);
+    float hammerAngleDrawn = glm_lerp(simulation.previousHammerAngle, hammerAnimationAngle, alpha);
 
     // Move o martelo para sua posição atual no mundo 3D
-    glTranslatef(hammerPosCurrent[0], hammerPosCurrent[1], hammerPosCurrent[2]);
+    glm_translate(hammerMatrix, hammerPosDrawn);
     
     // Orienta o martelo baseado no estado
     if (hammerState == IDLE || (hammerState == RETURNING && hammerAnimationMovingtoTarget < 0.1f)) {
         // Em IDLE: aponta na mesma direção da câmera
-        float yaw = glm_deg(atan2f(cameraFront[0], cameraFront[2]));
-        float pitch = glm_deg(asinf(-cameraFront[1]));
+        float yaw = atan2f(viewFront[0], viewFront[2]);
+        float pitch = asinf(-viewFront[1]);
         
-        glRotatef(yaw, 0.0f, 1.0f, 0.0f);   // Rotação horizontal (segue câmera)
-        glRotatef(pitch, 1.0f, 0.0f, 0.0f); // Rotação vertical (segue câmera)
-        glRotatef(90.0f, 0.0f, 1.0f, 0.0f); // Gira 90° para ficar de frente
+        glm_rotate_y(hammerMatrix, yaw, hammerMatrix);              // Rotação horizontal (segue câmera)
+        glm_rotate_x(hammerMatrix, pitch, hammerMatrix);            // Rotação vertical (segue câmera)
+        glm_rotate_y(hammerMatrix, glm_rad(90.0f), hammerMatrix);   // Gira 90° para ficar de frente
         
     } else {
         // Em ataque: aponta para o alvo
         vec3 hammerToTarget;
-        glm_vec3_sub(hammerPosTarget, hammerPosCurrent, hammerToTarget);
+        glm_vec3_sub(hammerPosTarget, hammerPosDrawn, hammerToTarget);
         
         if (glm_vec3_norm(hammerToTarget) > 0.01f) {
             glm_vec3_normalize(hammerToTarget);
             
             // Calcula ângulos de rotação para apontar para o alvo
-            float yaw = glm_deg(atan2f(hammerToTarget[0], hammerToTarget[2]));
-            float pitch = glm_deg(asinf(-hammerToTarget[1]));
+            float yaw = atan2f(hammerToTarget[0], hammerToTarget[2]);
+            float pitch = asinf(-hammerToTarget[1]);
             
-            glRotatef(yaw, 0.0f, 1.0f, 0.0f);   // Rotação horizontal
-            glRotatef(pitch, 1.0f, 0.0f, 0.0f); // Rotação vertical
+            glm_rotate_y(hammerMatrix, yaw, hammerMatrix);   // Rotação horizontal
+            glm_rotate_x(hammerMatrix, pitch, hammerMatrix); // Rotação vertical
         }
     }
 
     // Escala o martelo baseada na distância (perspectiva automática)
-    glScalef(hammerCurrentScale, hammerCurrentScale, hammerCurrentScale);
+    glm_scale_uni(hammerMatrix, hammerScaleDrawn);
 
-    
-    glTranslatef(0.0f, -2.5f, 0.0f); // Move o martelo para BAIXO (cabo em 0,0,0)
+    glm_translate(hammerMatrix, (vec3){ 0.0f, -2.5f, 0.0f }); // Move o martelo para BAIXO (cabo em 0,0,0)
     // 1. Rotaciona PRIMEIRO em torno da origem (marretada)
     //    A origem será onde o cabo fica (pivô fixo)
-    glRotatef(hammerAnimationAngle, 0.0f, 0.0f, 1.0f);
-    
+    glm_rotate_z(hammerMatrix, glm_rad(hammerAngleDrawn), hammerMatrix);
 
     // Desenha o martelo com primitivas OpenGL
-    drawHammer();
-
-    glPopMatrix(); // Restaura a matriz original
-    
-    // Reabilita depth test para os demais objetos
-    glEnable(GL_DEPTH_TEST);
+    drawHammer(hammerMatrix);
+    RenderQueue_Execute(RENDER_PASS_OVERLAY);
+    Profiler_End(PROFILE_HAMMER);
 
     // --- Desenha Score HUD ---
-    char scoreStr[64];
-    sprintf(scoreStr, "Score: %d", score);
-    
+    Profiler_Begin(PROFILE_HUD);
     glMatrixMode(GL_PROJECTION);
     glPushMatrix();
     glLoadIdentity();
@@ -1117,12 +1471,8 @@ void renderScene(void) {
     glPushMatrix();
     glLoadIdentity();
     
-    glColor3f(1.0f, 1.0f, 1.0f);
-    glRasterPos2i(10, screen_height - 20);
-    for (char* c = scoreStr; *c; c++) {
-        glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
-    }
     // Timer HUD
+    int remainingSeconds = -1;
     if (gameActive && gameEndTimeMs > 0) {
         unsigned int now = glutGet(GLUT_ELAPSED_TIME);
         int remainingMs = (int)gameEndTimeMs - (int)now;
@@ -1134,221 +1484,102 @@ void renderScene(void) {
             gameActive = 0; // pausa a lógica
             remainingMs = 0;
         }
-
-        int totalSeconds = remainingMs / 1000;
-        int minutes = totalSeconds / 60;
-        int seconds = totalSeconds % 60;
-        char timeStr[64];
-        sprintf(timeStr, "Tempo: %02d:%02d", minutes, seconds);
-
-        glColor3f(1.0f, 1.0f, 0.2f);
-        glRasterPos2i(10, screen_height - 40);
-        for (char* c = timeStr; *c; c++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
-
-        if (isPaused) {
-            char pausedStr[] = " (PAUSADO)";
-            for (char* c = pausedStr; *c; c++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
-        }
+        remainingSeconds = remainingMs / 1000;
+        // Acorda na virada do próximo segundo para atualizar o timer
+        if (remainingMs > 0) Frame_RequestRedrawIn((unsigned int)(remainingMs % 1000) + 1);
     }
+    // Placar e timer: painel em cache, refeito quando o score ou o segundo mudam
+    int scoreboardInputs[] = { score, remainingSeconds, isPaused };
+    Overlay_Draw(OVERLAY_SCOREBOARD, scoreboardInputs, 3);
 
     // pausa HUD
     {
-        char pauseHint[] = "P - Pausa/Resume";
-        glColor3f(0.8f, 0.8f, 0.8f);
-        glRasterPos2i(10, screen_height - 60);
-        for (char* c = pauseHint; *c; c++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
-    }
-
-    // menu overlay
-    if (inMenu) {
-        glMatrixMode(GL_PROJECTION);
-        glPushMatrix();
-        glLoadIdentity();
-        gluOrtho2D(0, screen_width, 0, screen_height);
-        glMatrixMode(GL_MODELVIEW);
-        glPushMatrix();
-        glLoadIdentity();
+        static const float hintColor[3] = { 0.8f, 0.8f, 0.8f };
+        char pauseStr[128];
+        snprintf(pauseStr, sizeof(pauseStr), "P - Pausa/Resume | F - Quadros: %s (limite %d), %.1f por segundo",
+                 Frame_ModeName(frameMode), frameRateCap, Frame_Rate());
+        Text_Draw(TEXT_FONT_SMALL, 10, screen_height - 60, hintColor, pauseStr);
+
+        char renderStr[256];
+        if (frustumCulling) {
+            sprintf(renderStr, "R - Render: %s (bonecos %s) | C - Culling: %u/%u malhas, %u/%u bonecos fora da tela",
+                    RenderBackend_Name(RenderBackend_Effective()), Bonecos_PathName(), cullStats.meshesCulled, cullStats.meshesTested,
+                    cullStats.bonecosCulled, cullStats.bonecosTested);
+        } else {
+            sprintf(renderStr, "R - Render: %s (bonecos %s) | C - Culling: desligado", RenderBackend_Name(RenderBackend_Effective()), Bonecos_PathName());
+        }
+        if (roomFromCubemap) {
+            size_t len = strlen(renderStr);
+            snprintf(renderStr + len, sizeof(renderStr) - len, " | I - Sala: cubemap %s (%d px)",
+                     RoomCubemap_QualityName(roomCubemapQuality), RoomCubemap_FaceSize());
+        }
+        unsigned int pvsReady, pvsTotal;
+        if (pvsEnabled && !roomFromCubemap && Pvs_Progress(&pvsReady, &pvsTotal)) {
+            size_t len = strlen(renderStr);
+            if (pvsReady < pvsTotal) snprintf(renderStr + len, sizeof(renderStr) - len, " | PVS: montando %u/%u", pvsReady, pvsTotal);
+            else snprintf(renderStr + len, sizeof(renderStr) - len, " | PVS: %u malhas ocultas", cullStats.meshesHidden);
+        }
+        Text_Draw(TEXT_FONT_SMALL, 10, screen_height - 80, hintColor, renderStr);
 
-    int boxW = 640, boxH = 420;
-    int boxX = (screen_width - boxW) / 2;
-    int boxY = (screen_height - boxH) / 2;
-    int topOffset = 80;
-    int optSpacing = 50;
+        char queueStr[128];
+        snprintf(queueStr, sizeof(queueStr), "Q - Fila: %s | estado do GL: %u trocas enviadas de %u pedidas",
+                 renderQueueEnabled ? "ordenada" : "desligada", stateStats.issued, stateStats.requested);
+        Text_Draw(TEXT_FONT_SMALL, 10, screen_height - 100, hintColor, queueStr);
+    }
 
-        // Fundo semi-transparente
-        glPushAttrib(GL_ALL_ATTRIB_BITS);
-        glDisable(GL_TEXTURE_2D);
-        glDisable(GL_LIGHTING);
-        glDisable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glColor4f(0.05f, 0.05f, 0.05f, 0.9f);
-        glBegin(GL_QUADS);
-            glVertex2i(boxX, boxY);
-            glVertex2i(boxX + boxW, boxY);
-            glVertex2i(boxX + boxW, boxY + boxH);
-            glVertex2i(boxX, boxY + boxH);
-        glEnd();
+    // progresso do streaming da sala
+    if (ourModel->state == MODEL_LOADING) {
+        char loadingStr[64];
+        unsigned int total = atomic_load(&ourModel->meshesTotal);
+        if (total > 0) sprintf(loadingStr, "Carregando sala: %u/%u malhas", ourModel->numMeshes, total);
+        else sprintf(loadingStr, "Carregando sala...");
+        Text_Draw(TEXT_FONT_SMALL, 10, screen_height - 120, (const float[3]){ 0.6f, 0.9f, 1.0f }, loadingStr);
+    }
 
-    // Opções do menu
-    const char* options[] = { "Iniciar Jogo", "Duração: ", "Modo Visual: ", "Ordenar por: ", "Pontuacoes", "Sair" };
-        char line[128];
-        // Desenha opção destacada com retângulo e depois o texto
-        for (int i = 0; i < menuOptionCount; i++) {
-            int y = boxY + boxH - topOffset - i * optSpacing;
-            if (i == 1) sprintf(line, "%s%d s", options[i], menuDurations[menuDurationIndex]);
-            else if (i == 2) sprintf(line, "%s%s", options[i], drawCubeMode ? "Bonecos 3D" : "Quadrados verdes");
-            else if (i == 3) sprintf(line, "%s%s", options[i], sortByScore ? "Melhores" : "Mais recentes");
-            else sprintf(line, "%s", options[i]);
-
-            // highlight background for selected
-            if (i == menuSelected) {
-                glColor4f(0.22f, 0.18f, 0.06f, 0.95f);
-                int txtW = boxW - 80;
-                glBegin(GL_QUADS);
-                    glVertex2i(boxX + 20, y - 12);
-                    glVertex2i(boxX + 20 + txtW, y - 12);
-                    glVertex2i(boxX + 20 + txtW, y + 30);
-                    glVertex2i(boxX + 20, y + 30);
-                glEnd();
-                glColor3f(1.0f, 0.95f, 0.3f);
-            } else {
-                glColor3f(1.0f, 1.0f, 1.0f);
-            }
+    // Todo o texto do HUD sai em uma chamada, antes dos painéis que ficam por cima
+    Text_Flush();
 
-            glRasterPos2i(boxX + 40, y + 8);
-            for (char* c = line; *c; c++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
-        }
+    // Painéis por cima do HUD: menu, lista de pontuações e modal final
+    if (inMenu) {
+        int menuInputs[] = { menuSelected, menuDurationIndex, drawCubeMode, sortByScore };
+        Overlay_Draw(OVERLAY_MENU, menuInputs, 4);
 
         // Se o usuário pediu para ver as Pontuações, desenha-as como um modal separado
         if (showScoresMenu) {
-            // Calcula ordenação/paginação
-            int total = matchHistoryCount;
-            int indices[MATCH_HISTORY_MAX];
-            for (int i = 0; i < total; i++) indices[i] = i;
-            if (sortByScore && total > 1) {
-                for (int a = 0; a < total-1; a++) for (int b = 0; b < total-1-a; b++) {
-                    if (matchHistory[indices[b]].score < matchHistory[indices[b+1]].score) {
-                        int t = indices[b]; indices[b] = indices[b+1]; indices[b+1] = t;
-                    }
-                }
-            } else {
-                for (int i = 0; i < total/2; i++) {
-                    int t = indices[i]; indices[i] = indices[total-1-i]; indices[total-1-i] = t;
-                }
-            }
-
-            int pages = (total + recordsPerPage - 1) / recordsPerPage;
-            if (pages == 0) pages = 1;
+            int pages = scoresPageCount();
             if (historyPage >= pages) historyPage = pages - 1;
-            int start = historyPage * recordsPerPage;
-            int show = ((total - start) < recordsPerPage) ? (total - start) : recordsPerPage;
-
-            // Desenha modal central (semelhante ao modal final)
-            glPopAttrib(); // garante estado limpo antes do modal
-            glPopMatrix(); glMatrixMode(GL_PROJECTION); glPopMatrix(); glMatrixMode(GL_MODELVIEW);
-
-            glMatrixMode(GL_PROJECTION);
-            glPushMatrix(); glLoadIdentity(); gluOrtho2D(0, screen_width, 0, screen_height);
-            glMatrixMode(GL_MODELVIEW); glPushMatrix(); glLoadIdentity();
-
-            int mw = 520, mh = 360;
-            int mx = (screen_width - mw)/2, my = (screen_height - mh)/2;
-
-            glPushAttrib(GL_ALL_ATTRIB_BITS);
-            glDisable(GL_TEXTURE_2D); glDisable(GL_LIGHTING); glDisable(GL_DEPTH_TEST);
-            glEnable(GL_BLEND); glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            // Fundo do modal
-            glColor4f(0.04f, 0.04f, 0.04f, 0.95f);
-            glBegin(GL_QUADS);
-                glVertex2i(mx, my);
-                glVertex2i(mx+mw, my);
-                glVertex2i(mx+mw, my+mh);
-                glVertex2i(mx, my+mh);
-            glEnd();
-
-            // Título
-            char title[128]; snprintf(title, sizeof(title), "Pontuações");
-            glColor3f(1.0f, 0.95f, 0.3f);
-            glRasterPos2i(mx+24, my+mh-40); for (char* c = title; *c; c++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
-
-            // Lista de pontuações
-            glColor3f(0.95f, 0.95f, 0.95f);
-            int listStartY = my + mh - 80;
-            for (int i = 0; i < show; i++) {
-                int idx = indices[start + i];
-                char buf[128];
-                snprintf(buf, sizeof(buf), "%s - Score: %d", matchHistory[idx].timeStr, matchHistory[idx].score);
-                glRasterPos2i(mx+32, listStartY - i * 28);
-                for (char* c = buf; *c; c++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
-            }
-
-            // Paginação e instrução de fechamento
-            char pageStr[64]; snprintf(pageStr, sizeof(pageStr), "Página %d/%d", historyPage+1, pages);
-            glRasterPos2i(mx + mw - 140, my + 28);
-            for (char* c = pageStr; *c; c++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
-
-            char hint[] = "Enter/Esc/M para fechar | <-/-> para navegar | T/t para pág.";
-            glRasterPos2i(mx+24, my+28); for (char* c = hint; *c; c++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
-
-            glPopAttrib();
-            glPopMatrix(); glMatrixMode(GL_PROJECTION); glPopMatrix(); glMatrixMode(GL_MODELVIEW);
-
-            // Re-abre matrizes para continuar o resto do render
-            glMatrixMode(GL_PROJECTION);
-            glPushMatrix(); glLoadIdentity(); gluOrtho2D(0, screen_width, 0, screen_height);
-            glMatrixMode(GL_MODELVIEW);
-            glPushMatrix(); glLoadIdentity();
-            // Re-aplica o atributo do menu drawing area para não quebrar o resto
-            glPushAttrib(GL_ALL_ATTRIB_BITS);
+            int scoresInputs[] = { historyPage, sortByScore, matchHistoryVersion };
+            Overlay_Draw(OVERLAY_SCORES, scoresInputs, 3);
         }
-
-        glPopAttrib();
-
-        glPopMatrix();
-        glMatrixMode(GL_PROJECTION);
-        glPopMatrix();
-        glMatrixMode(GL_MODELVIEW);
     }
 
     // Exibe modal final se necessário
     if (showFinalModal) {
-        glMatrixMode(GL_PROJECTION);
-        glPushMatrix(); glLoadIdentity(); gluOrtho2D(0, screen_width, 0, screen_height);
-        glMatrixMode(GL_MODELVIEW); glPushMatrix(); glLoadIdentity();
-
-        int w = 420, h = 220;
-        int x = (screen_width - w)/2, y = (screen_height - h)/2;
-        glPushAttrib(GL_ALL_ATTRIB_BITS);
-        glDisable(GL_TEXTURE_2D); glDisable(GL_LIGHTING); glDisable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND); glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glColor4f(0.05f, 0.05f, 0.05f, 0.95f);
-        glBegin(GL_QUADS);
-            glVertex2i(x, y);
-            glVertex2i(x+w, y);
-            glVertex2i(x+w, y+h);
-            glVertex2i(x, y+h);
-        glEnd();
-
-        char title[128]; snprintf(title, sizeof(title), "Partida finalizada!");
-        char body[128]; snprintf(body, sizeof(body), "Score final: %d", score);
-        glColor3f(1,1,1);
-        glRasterPos2i(x+24, y+h-48); for (char* c = title; *c; c++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
-        glRasterPos2i(x+24, y+h-88); for (char* c = body; *c; c++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
-
-        char hint[] = "Pressione Enter para voltar ao menu";
-        glRasterPos2i(x+24, y+24); for (char* c = hint; *c; c++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
-
-        glPopAttrib();
-        glPopMatrix(); glMatrixMode(GL_PROJECTION); glPopMatrix(); glMatrixMode(GL_MODELVIEW);
+        int finalInputs[] = { score };
+        Overlay_Draw(OVERLAY_FINAL, finalInputs, 1);
     }
+    Profiler_End(PROFILE_HUD);
+
+    // Perfil por cima de tudo, fora dos trechos medidos
+    if (profilerVisible) Profiler_Draw();
     
     glPopMatrix();
     glMatrixMode(GL_PROJECTION);
     glPopMatrix();
     glMatrixMode(GL_MODELVIEW);
 
-    glutSwapBuffers();
+    Profiler_Begin(PROFILE_SWAP);
+    if (headlessFrames) glFinish(); // pbuffer: nada a trocar, o benchmark mede até a GPU terminar
+    else glutSwapBuffers();
+    Profiler_End(PROFILE_SWAP);
+    Profiler_EndFrame();
+    Frame_End();
+
+    static int firstFramePrinted = 0;
+    if (!firstFramePrinted) {
+        firstFramePrinted = 1;
+        printf("Primeiro quadro em %.2f ms desde o início do processo\n", (Clock_NowNs() - processStartNs) / 1e6);
+    }
 }
 
 void reshape(int width, int height) {
@@ -1407,12 +1638,12 @@ void mouseButton(int button, int state, int x, int y) {
                 int arrowRightX1 = boxX + boxW - 120, arrowRightX2 = boxX + boxW - 100;
                 int arrowY1 = boxY + 16, arrowY2 = boxY + 36;
                 if (x >= arrowLeftX1 && x <= arrowLeftX2 && winY >= arrowY1 && winY <= arrowY2 && historyPage > 0) {
-                    historyPage--; glutPostRedisplay(); return;
+                    historyPage--; Frame_RequestRedraw(); return;
                 }
                 if (x >= arrowRightX1 && x <= arrowRightX2 && winY >= arrowY1 && winY <= arrowY2 && historyPage < pages - 1) {
-                    historyPage++; glutPostRedisplay(); return;
+                    historyPage++; Frame_RequestRedraw(); return;
                 }
-                glutPostRedisplay();
+                Frame_RequestRedraw();
                 return;
             }
         }
@@ -1502,6 +1733,7 @@ void mouseButton(int button, int state, int x, int y) {
                 hammerCurrentScale = hammerBaseScale;
                 cameraTurnProgress = 0.0f; // Reseta o progresso da câmera
                 hammerState = MOVING_TO_TARGET;
+                Frame_RequestRedraw();
             }
         }
     }
@@ -1523,303 +1755,5231 @@ void mouseMove(int x, int y) {
     if (cameraPitch > 89.0f) cameraPitch = 89.0f;
     if (cameraPitch < -89.0f) cameraPitch = -89.0f;
 
-    glutPostRedisplay(); // Solicita um redesenho da cena
+    Frame_RequestRedraw(); // Solicita um redesenho da cena
 }
 
 void cleanup(void) {
     printf("Limpando recursos...\n");
+    if (loadProfileJsonPath) LoadProfile_DumpJson(loadProfileJsonPath);
+    Pvs_Shutdown();
+    RoomCubemap_Shutdown();
+    Bonecos_Shutdown();
+    Primitive_Shutdown();
+    RenderQueue_Shutdown();
+    Overlay_Shutdown();
+    Profiler_Shutdown();
+    Text_Shutdown();
     Model_Destroy(ourModel);
     Model_Destroy(menModel); // Libera modelo do tronco
-    // Martelo agora é primitiva OpenGL - não precisa destruir modelo
+    JobPool_Shutdown();
 }
 
-// ---- Funções de carregamento (refatoradas) ----
+// ---- Relógio monotônico e perfil de carregamento ----
 
-// Protótipos para as novas funções (coloque com os outros protótipos se preferir)
-void processNode_pass1_count(struct aiNode* node, const struct aiScene* scene, unsigned int* meshCounter, unsigned int* textureCounter);
-void processNode_pass2_fillData(struct aiNode* node, const struct aiScene* scene, Model* model, unsigned int* mesh_idx_counter);
-void loadMaterialTextures_fillData(struct aiMaterial* mat, enum aiTextureType type, const char* typeName, Mesh* outMesh, Model* model);
+uint64_t Clock_NowNs(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER counter;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / freq.QuadPart) * 1000000000ull
+         + (uint64_t)(counter.QuadPart % freq.QuadPart) * 1000000000ull / (uint64_t)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
 
-// Passa 1: Percorre a cena para contar o total de malhas e texturas únicas
-void processNode_pass1_count(struct aiNode* node, const struct aiScene* scene, unsigned int* meshCounter, unsigned int* textureCounter) {
-    *meshCounter += node->mNumMeshes;
-    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-        struct aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        if (mesh->mMaterialIndex >= 0) {
-            struct aiMaterial* mat = scene->mMaterials[mesh->mMaterialIndex];
-            *textureCounter += aiGetMaterialTextureCount(mat, aiTextureType_DIFFUSE);
-        }
-    }
-    for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        processNode_pass1_count(node->mChildren[i], scene, meshCounter, textureCounter);
-    }
+static const char* loadPhaseNames[LOAD_PHASE_MAX] = {
+    "cache_read", "assimp_import", "pass1_count", "vertex_copy", "index_flatten",
+    "material_resolve", "texture_decode", "gl_upload", "cache_write", "material_merge",
+    "quantize", "obj_parse", "buffer_upload"
+};
+
+static LoadProfile* loadProfiles = NULL; // todos os perfis, para o dump em JSON
+static pthread_mutex_t loadProfilesMutex = PTHREAD_MUTEX_INITIALIZER;
+const char* loadProfileJsonPath = NULL;  // --load-profile <arquivo.json>
+
+LoadProfile* LoadProfile_Create(const char* name) {
+    LoadProfile* profile = (LoadProfile*)calloc(1, sizeof(LoadProfile));
+    strncpy(profile->name, name, sizeof(profile->name) - 1);
+    pthread_mutex_lock(&loadProfilesMutex);
+    profile->next = loadProfiles;
+    loadProfiles = profile;
+    pthread_mutex_unlock(&loadProfilesMutex);
+    return profile;
 }
 
-//  Preenche os dados nas estruturas já alocadas
-void processNode_pass2_fillData(struct aiNode* node, const struct aiScene* scene, Model* model, unsigned int* mesh_idx_counter) {
-    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-        struct aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        model->meshes[*mesh_idx_counter] = processMesh(mesh, scene, model);
-        (*mesh_idx_counter)++;
+// Acumula uma medida; pode ser chamado de qualquer thread. profile NULL é ignorado.
+void LoadProfile_Add(LoadProfile* profile, LoadPhase phase, uint64_t startNs) {
+    if (!profile) return;
+    atomic_fetch_add(&profile->phaseNs[phase], Clock_NowNs() - startNs);
+    atomic_fetch_add(&profile->phaseCalls[phase], 1);
+}
+
+void LoadProfile_Print(const LoadProfile* profile) {
+    printf("  Perfil de carga de %s: total %.2f ms\n", profile->name, profile->wallNs / 1e6);
+    for (int i = 0; i < LOAD_PHASE_MAX; i++) {
+        unsigned int calls = atomic_load(&profile->phaseCalls[i]);
+        if (calls == 0) continue;
+        printf("    %-17s %9.3f ms (%u)\n", loadPhaseNames[i], atomic_load(&profile->phaseNs[i]) / 1e6, calls);
     }
-    for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        processNode_pass2_fillData(node->mChildren[i], scene, model, mesh_idx_counter);
+}
+
+int LoadProfile_DumpJson(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) { fprintf(stderr, "Falha ao gravar %s\n", path); return 0; }
+    fprintf(f, "{\n  \"models\": [");
+    pthread_mutex_lock(&loadProfilesMutex);
+    for (LoadProfile* profile = loadProfiles; profile; profile = profile->next) {
+        fprintf(f, "%s\n    {\n      \"name\": \"", profile == loadProfiles ? "" : ",");
+        for (const char* c = profile->name; *c; c++) {
+            if (*c == '"' || *c == '\\') fputc('\\', f);
+            fputc(*c, f);
+        }
+        fprintf(f, "\",\n      \"wall_ns\": %llu,\n      \"phases\": {", (unsigned long long)profile->wallNs);
+        int first = 1;
+        for (int i = 0; i < LOAD_PHASE_MAX; i++) {
+            unsigned int calls = atomic_load(&profile->phaseCalls[i]);
+            if (calls == 0) continue;
+            fprintf(f, "%s\n        \"%s\": { \"ns\": %llu, \"calls\": %u }", first ? "" : ",",
+                    loadPhaseNames[i], (unsigned long long)atomic_load(&profile->phaseNs[i]), calls);
+            first = 0;
+        }
+        fprintf(f, "\n      }\n    }");
     }
+    pthread_mutex_unlock(&loadProfilesMutex);
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+    printf("Perfil de carregamento gravado em %s\n", path);
+    return 1;
 }
 
+// ---- Pool de threads de trabalho ----
+// Fila única de tarefas consumida por threads fixas. Usado no carregamento para o
+// trabalho de CPU; tudo que toca em OpenGL continua na thread do GLUT.
 
-void loadMaterialTextures_fillData(struct aiMaterial* mat, enum aiTextureType type, const char* typeName, Mesh* outMesh, Model* model) {
-    unsigned int texture_count_in_mat = aiGetMaterialTextureCount(mat, type);
-    if (texture_count_in_mat == 0) return;
+typedef void (*JobFunc)(void* arg);
 
-    outMesh->textures = (Texture*)malloc(texture_count_in_mat * sizeof(Texture));
-    outMesh->numTextures = 0;
+typedef struct Job {
+    JobFunc fn;
+    void* arg;
+    struct Job* next;
+} Job;
 
-    for (unsigned int i = 0; i < texture_count_in_mat; i++) {
-        struct aiString str;
-        aiGetMaterialTexture(mat, type, i, &str, NULL, NULL, NULL, NULL, NULL, NULL);
+static pthread_t* jobThreads = NULL;
+static int jobThreadCount = 0;
+static int jobPoolStopping = 0;
+static Job* jobQueueHead = NULL;
+static Job* jobQueueTail = NULL;
+static pthread_mutex_t jobMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobCond = PTHREAD_COND_INITIALIZER;
 
-        bool found = false;
-        for (unsigned int j = 0; j < model->num_textures_loaded; j++) {
-            if (strcmp(model->textures_loaded[j].path, str.data) == 0) {
-                outMesh->textures[outMesh->numTextures++] = model->textures_loaded[j];
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
-            Texture texture;
-            texture.id = TextureFromFile(str.data, model->directory);
-            texture.type = (char*)malloc(strlen(typeName) + 1);
-            strcpy(texture.type, typeName);
-            texture.path = (char*)malloc(strlen(str.data) + 1);
-            strcpy(texture.path, str.data);
-            
-            outMesh->textures[outMesh->numTextures++] = texture;
-            model->textures_loaded[model->num_textures_loaded++] = texture;
-        }
+int JobPool_CpuCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+static void* jobWorkerMain(void* unused) {
+    (void)unused;
+    for (;;) {
+        pthread_mutex_lock(&jobMutex);
+        while (!jobQueueHead && !jobPoolStopping) pthread_cond_wait(&jobCond, &jobMutex);
+        if (!jobQueueHead) { pthread_mutex_unlock(&jobMutex); break; }
+        Job* job = jobQueueHead;
+        jobQueueHead = job->next;
+        if (!jobQueueHead) jobQueueTail = NULL;
+        pthread_mutex_unlock(&jobMutex);
+
+        job->fn(job->arg);
+        free(job);
     }
+    return NULL;
 }
 
+// numThreads <= 0 usa (núcleos - 1): a thread principal também trabalha no ParallelFor
+void JobPool_Init(int numThreads) {
+    if (jobThreads) return;
+    if (numThreads <= 0) numThreads = JobPool_CpuCount() - 1;
+    if (numThreads <= 0) return; // máquina de 1 núcleo: tudo roda serialmente
+    jobThreads = (pthread_t*)malloc(numThreads * sizeof(pthread_t));
+    for (int i = 0; i < numThreads; i++) {
+        if (pthread_create(&jobThreads[i], NULL, jobWorkerMain, NULL) != 0) break;
+        jobThreadCount++;
+    }
+    printf("Pool de trabalho: %d threads\n", jobThreadCount);
+}
 
-// Nova função Model_Create que orquestra tudo
-Model* Model_Create(const char* path) {
-    printf("\n--- INICIANDO CARREGAMENTO DE: %s ---\n", path);
-    Model* model = (Model*)malloc(sizeof(Model));
-    if (!model) return NULL;
-    model->meshes = NULL; model->numMeshes = 0; model->textures_loaded = NULL; model->num_textures_loaded = 0; model->directory = NULL;
+void JobPool_Submit(JobFunc fn, void* arg) {
+    if (jobThreadCount == 0) { fn(arg); return; }
+    Job* job = (Job*)malloc(sizeof(Job));
+    job->fn = fn; job->arg = arg; job->next = NULL;
+    pthread_mutex_lock(&jobMutex);
+    if (jobQueueTail) jobQueueTail->next = job; else jobQueueHead = job;
+    jobQueueTail = job;
+    pthread_cond_signal(&jobCond);
+    pthread_mutex_unlock(&jobMutex);
+}
 
-    const struct aiScene* scene = aiImportFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-        fprintf(stderr, "ERRO::ASSIMP:: %s\n", aiGetErrorString());
-        free(model);
-        return NULL;
-    }
-    
-    // Extrai diretório
-    const char* last_slash = strrchr(path, '/'); const char* last_backslash = strrchr(path, '\\');
-    const char* final_separator = (last_slash > last_backslash) ? last_slash : last_backslash;
-    if (final_separator) { size_t dir_len = final_separator - path; model->directory = (char*)malloc(dir_len + 1); strncpy(model->directory, path, dir_len); model->directory[dir_len] = '\0'; }
-    else { model->directory = (char*)malloc(2); strcpy(model->directory, "."); }
+typedef struct {
+    void (*fn)(unsigned int index, void* ctx);
+    void* ctx;
+    unsigned int count;
+    atomic_uint next;
+    int pendingHelpers;
+    pthread_mutex_t mutex;
+    pthread_cond_t done;
+} ParallelBatch;
+
+static void parallelBatchRun(ParallelBatch* batch) {
+    unsigned int i;
+    while ((i = atomic_fetch_add(&batch->next, 1)) < batch->count) batch->fn(i, batch->ctx);
+}
 
-    // --- NOVA LÓGICA DE ALOCAÇÃO EM PASSOS ---
-    // 1. Contar tudo primeiro
-    unsigned int totalMeshes = 0;
-    unsigned int totalTextures = 0;
-    processNode_pass1_count(scene->mRootNode, scene, &totalMeshes, &totalTextures);
-    model->numMeshes = totalMeshes;
+static void parallelBatchJob(void* arg) {
+    ParallelBatch* batch = (ParallelBatch*)arg;
+    parallelBatchRun(batch);
+    pthread_mutex_lock(&batch->mutex);
+    if (--batch->pendingHelpers == 0) pthread_cond_signal(&batch->done);
+    pthread_mutex_unlock(&batch->mutex);
+}
 
-    // 2. Alocar memória de uma só vez
-    model->meshes = (Mesh*)malloc(model->numMeshes * sizeof(Mesh));
-    if (totalTextures > 0) {
-        model->textures_loaded = (Texture*)malloc(totalTextures * sizeof(Texture));
+// Executa fn(0..count-1) no pool; a thread chamadora participa e só retorna no fim
+void JobPool_ParallelFor(unsigned int count, void (*fn)(unsigned int index, void* ctx), void* ctx) {
+    unsigned int helpers = (unsigned int)jobThreadCount;
+    if (count > 0 && helpers > count - 1) helpers = count - 1;
+    if (helpers == 0) {
+        for (unsigned int i = 0; i < count; i++) fn(i, ctx);
+        return;
     }
 
-    // 3. Preencher os dados
-    unsigned int mesh_index_counter = 0;
-    model->num_textures_loaded = 0; // Será usado como contador
-    processNode_pass2_fillData(scene->mRootNode, scene, model, &mesh_index_counter);
-    
-    aiReleaseImport(scene);
-    printf("--- CARREGAMENTO DE %s CONCLUÍDO ---\n", path);
-    return model;
+    ParallelBatch batch;
+    batch.fn = fn; batch.ctx = ctx; batch.count = count;
+    atomic_init(&batch.next, 0);
+    batch.pendingHelpers = (int)helpers;
+    pthread_mutex_init(&batch.mutex, NULL);
+    pthread_cond_init(&batch.done, NULL);
+
+    for (unsigned int i = 0; i < helpers; i++) JobPool_Submit(parallelBatchJob, &batch);
+    parallelBatchRun(&batch);
+
+    pthread_mutex_lock(&batch.mutex);
+    while (batch.pendingHelpers > 0) pthread_cond_wait(&batch.done, &batch.mutex);
+    pthread_mutex_unlock(&batch.mutex);
+    pthread_mutex_destroy(&batch.mutex);
+    pthread_cond_destroy(&batch.done);
 }
 
-Mesh processMesh(struct aiMesh* mesh, const struct aiScene* scene, Model* model) {
-    printf("  [processMesh] Processando uma malha com %u vértices e %u faces.\n", mesh->mNumVertices, mesh->mNumFaces);
-    time_t start_mesh, end_mesh;
-    time(&start_mesh);
+void JobPool_Shutdown(void) {
+    if (!jobThreads) return;
+    pthread_mutex_lock(&jobMutex);
+    jobPoolStopping = 1;
+    pthread_cond_broadcast(&jobCond);
+    pthread_mutex_unlock(&jobMutex);
+    for (int i = 0; i < jobThreadCount; i++) pthread_join(jobThreads[i], NULL);
+    free(jobThreads);
+    jobThreads = NULL;
+    jobThreadCount = 0;
+}
 
-    Mesh newMesh = {0};
-    
-    time_t start_step = time(NULL);
-    // Carrega Vértices
-    newMesh.numVertices = mesh->mNumVertices;
-    newMesh.vertices = (Vertex*)malloc(newMesh.numVertices * sizeof(Vertex));
-    for (unsigned int i = 0; i < newMesh.numVertices; i++) {
-        newMesh.vertices[i].position[0] = mesh->mVertices[i].x; newMesh.vertices[i].position[1] = mesh->mVertices[i].y; newMesh.vertices[i].position[2] = mesh->mVertices[i].z;
-        if (mesh->mNormals) { newMesh.vertices[i].normal[0] = mesh->mNormals[i].x; newMesh.vertices[i].normal[1] = mesh->mNormals[i].y; newMesh.vertices[i].normal[2] = mesh->mNormals[i].z; }
-        if (mesh->mTextureCoords[0]) { newMesh.vertices[i].texCoords[0] = mesh->mTextureCoords[0][i].x; newMesh.vertices[i].texCoords[1] = mesh->mTextureCoords[0][i].y; }
-        else { glm_vec2_zero(newMesh.vertices[i].texCoords); }
-    }
-    printf("    - Vértices copiados em %.2f seg.\n", difftime(time(NULL), start_step));
-
-    start_step = time(NULL);
-    // Carrega Índices
-    unsigned int total_indices = 0;
-    for (unsigned int i = 0; i < mesh->mNumFaces; i++) { total_indices += mesh->mFaces[i].mNumIndices; }
-    newMesh.numIndices = total_indices;
-    newMesh.indices = (unsigned int*)malloc(newMesh.numIndices * sizeof(unsigned int));
-    unsigned int index_counter = 0;
-    for (unsigned int i = 0; i < mesh->mNumFaces; i++) { struct aiFace face = mesh->mFaces[i]; for (unsigned int j = 0; j < face.mNumIndices; j++) { newMesh.indices[index_counter++] = face.mIndices[j]; } }
-    printf("    - Índices copiados em %.2f seg.\n", difftime(time(NULL), start_step));
-    
-    start_step = time(NULL);
-    // Processa materiais
-    if (mesh->mMaterialIndex >= 0) {
-        struct aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-        loadMaterialTextures_fillData(material, aiTextureType_DIFFUSE, "texture_diffuse", &newMesh, model);
-        if (newMesh.numTextures == 0) {
-            struct aiColor4D color;
-            if (aiGetMaterialColor(material, AI_MATKEY_COLOR_DIFFUSE, &color) == AI_SUCCESS) { newMesh.diffuseColor[0] = color.r; newMesh.diffuseColor[1] = color.g; newMesh.diffuseColor[2] = color.b; }
-            else { glm_vec3_one(newMesh.diffuseColor); }
+// ---- Carregamento assíncrono de texturas ----
+// O objeto de textura é criado na hora com um texel branco provisório; o JPEG/PNG é
+// decodificado no pool e os pixels voltam para a thread do GL, que faz o upload em
+// TextureLoader_PumpUploads (chamado a cada quadro). A cadeia de mipmaps é montada na
+// mesma thread do pool (filtro de caixa 2x2) e a textura é amostrada com filtro
+// trilinear; --no-mipmaps volta ao nível 0 com GL_LINEAR. Com --compress-textures e
+// GL_EXT_texture_compression_s3tc o driver guarda cada nível em DXT1 (RGB) ou DXT5
+// (RGBA). Com --texture-cache os níveis prontos (já comprimidos, se for o caso) vão para
+// "<imagem>.texcache" e, nas execuções seguintes, são enviados direto, sem decodificar.
+
+#define TEXTURE_MAX_LEVELS 16
+#define TEXTURE_CACHE_MAGIC "AATEX\0\0"
+#define TEXTURE_CACHE_VERSION 1
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+int textureMipmaps = 1;             // --no-mipmaps desliga
+int textureCompression = 0;         // --compress-textures
+int textureCacheEnabled = 0;        // --texture-cache
+static int textureCompressionActive = -1; // -1: extensão ainda não consultada
+
+typedef struct TextureUpload {
+    GLuint id;
+    char filename[512];
+    LoadProfile* profile;  // modelo que pediu a textura (pode ser NULL)
+    unsigned char* pixels; // todos os níveis em sequência; NULL se a decodificação falhou
+    int width, height, channels;
+    GLenum compressedFormat;  // níveis já comprimidos (do cache); 0 = channels bytes por texel
+    int numLevels;
+    size_t levelSize[TEXTURE_MAX_LEVELS];
+    int fromCache;
+    int cancelled;         // TextureRegistry_Release apagou a textura: não enviar
+    struct TextureUpload* next;
+    struct TextureUpload* nextInFlight;
+} TextureUpload;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint32_t width, height, channels;
+    uint32_t compressedFormat;
+    uint32_t numLevels;   // seguido por numLevels x uint32 (bytes do nível) e pelos níveis
+} TextureCacheHeader;
+
+static TextureUpload* textureUploadsReady = NULL;
+static pthread_mutex_t textureUploadMutex = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int texturesPending = 0;
+static TextureUpload* textureUploadsInFlight = NULL; // pedidos ainda sem upload; só na thread do GL
+static size_t textureBytesLevel0 = 0, textureBytesGpu = 0; // soma das texturas enviadas
+static unsigned int textureUploadGeneration = 0; // cresce a cada textura enviada ao GL
+
+// Procura a extensão na lista do driver (formatos como S3TC não são do núcleo)
+static int glHasExtension(const char* name) {
+    if (GLAD_GL_VERSION_3_0) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0) return 1;
         }
+        return 0;
     }
-    printf("    - Materiais processados em %.2f seg.\n", difftime(time(NULL), start_step));
-    
-    time(&end_mesh);
-    printf("  [processMesh] Malha concluída em %.2f segundos.\n", difftime(end_mesh, start_mesh));
-    return newMesh;
+    const char* list = (const char*)glGetString(GL_EXTENSIONS);
+    size_t len = strlen(name);
+    for (const char* p = list; p && (p = strstr(p, name)) != NULL; p += len) {
+        if ((p == list || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0')) return 1;
+    }
+    return 0;
 }
 
-void Model_Draw(Model* model) {
-    for (unsigned int i = 0; i < model->numMeshes; i++) {
-        Mesh* currentMesh = &model->meshes[i];
+// Formato comprimido para a imagem, ou 0 (sem compressão, ou luminância)
+static GLenum textureCompressedFormat(int channels) {
+    if (textureCompressionActive != 1 || channels < 3) return 0;
+    return channels == 4 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+}
 
-        if (currentMesh->numTextures > 0) {
-            glEnable(GL_TEXTURE_2D);
-            glBindTexture(GL_TEXTURE_2D, currentMesh->textures[0].id);
-        } else {
-            glDisable(GL_TEXTURE_2D);
-            glColor3fv((const GLfloat*)currentMesh->diffuseColor);
-        }
+static const char* textureFormatName(GLenum compressedFormat) {
+    if (compressedFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) return "DXT1";
+    if (compressedFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) return "DXT5";
+    return "sem compressão";
+}
 
-        glBegin(GL_TRIANGLES);
-        for (unsigned int j = 0; j < currentMesh->numIndices; j++) {
-            unsigned int vertexIndex = currentMesh->indices[j];
-            
-            if (currentMesh->numTextures > 0) {
-                glTexCoord2fv((const GLfloat*)currentMesh->vertices[vertexIndex].texCoords);
+static int textureLevelCount(int width, int height) {
+    if (!textureMipmaps) return 1;
+    int levels = 1;
+    while ((width > 1 || height > 1) && levels < TEXTURE_MAX_LEVELS) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        levels++;
+    }
+    return levels;
+}
+
+static int textureLevelDimension(int size, int level) {
+    size >>= level;
+    return size > 0 ? size : 1;
+}
+
+// Meio tamanho por média de 2x2 (a última linha/coluna de um lado ímpar fica de fora)
+static void textureDownsample(const unsigned char* src, int width, int height, int channels, unsigned char* dst) {
+    int dstWidth = width > 1 ? width / 2 : 1, dstHeight = height > 1 ? height / 2 : 1;
+    for (int y = 0; y < dstHeight; y++) {
+        const unsigned char* row0 = src + (size_t)(2 * y) * width * channels;
+        const unsigned char* row1 = height > 1 ? row0 + (size_t)width * channels : row0;
+        for (int x = 0; x < dstWidth; x++) {
+            int x0 = 2 * x * channels, x1 = width > 1 ? x0 + channels : x0;
+            for (int c = 0; c < channels; c++) {
+                *dst++ = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
             }
-            glNormal3fv((const GLfloat*)currentMesh->vertices[vertexIndex].normal);
-            glVertex3fv((const GLfloat*)currentMesh->vertices[vertexIndex].position);
         }
-        glEnd();
+    }
+}
 
-        glBindTexture(GL_TEXTURE_2D, 0);
+// Troca o nível 0 do stb_image por um bloco com a cadeia inteira
+static int textureBuildLevels(TextureUpload* upload, unsigned char* level0) {
+    upload->numLevels = textureLevelCount(upload->width, upload->height);
+    size_t total = 0;
+    for (int l = 0; l < upload->numLevels; l++) {
+        upload->levelSize[l] = (size_t)textureLevelDimension(upload->width, l) * textureLevelDimension(upload->height, l) * upload->channels;
+        total += upload->levelSize[l];
     }
+    upload->pixels = (unsigned char*)malloc(total);
+    if (!upload->pixels) return 0;
+    memcpy(upload->pixels, level0, upload->levelSize[0]);
+    unsigned char* level = upload->pixels;
+    for (int l = 1; l < upload->numLevels; l++) {
+        textureDownsample(level, textureLevelDimension(upload->width, l - 1), textureLevelDimension(upload->height, l - 1),
+                          upload->channels, level + upload->levelSize[l - 1]);
+        level += upload->levelSize[l - 1];
+    }
+    return 1;
 }
 
-void Model_Destroy(Model* model) {
-    if (!model) return;
+static void textureCachePathFor(const char* path, char* out, size_t outSize) {
+    snprintf(out, outSize, "%s.texcache", path);
+}
 
-    // Libera as malhas
-    if (model->meshes) {
-        for (unsigned int i = 0; i < model->numMeshes; i++) {
-            if (model->meshes[i].vertices) free(model->meshes[i].vertices);
-            if (model->meshes[i].indices) free(model->meshes[i].indices);
-            if (model->meshes[i].textures) free(model->meshes[i].textures);
-        }
-        free(model->meshes);
+// Lê os níveis do cache se ele bate com o fonte e com as opções atuais. Roda no pool.
+static int textureCacheLoad(TextureUpload* upload) {
+    struct stat st;
+    if (stat(upload->filename, &st) != 0) return 0;
+    char cachePath[1024];
+    textureCachePathFor(upload->filename, cachePath, sizeof(cachePath));
+    FILE* f = fopen(cachePath, "rb");
+    if (!f) return 0;
+
+    TextureCacheHeader header;
+    uint32_t sizes[TEXTURE_MAX_LEVELS];
+    int ok = fread(&header, sizeof(header), 1, f) == 1
+        && memcmp(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic)) == 0
+        && header.version == TEXTURE_CACHE_VERSION
+        && header.sourceSize == (uint64_t)st.st_size
+        && header.sourceMtime == (int64_t)st.st_mtime
+        && header.channels >= 1 && header.channels <= 4
+        && header.compressedFormat == textureCompressedFormat((int)header.channels)
+        && header.numLevels == (uint32_t)textureLevelCount((int)header.width, (int)header.height)
+        && fread(sizes, sizeof(uint32_t), header.numLevels, f) == header.numLevels;
+    size_t total = 0;
+    for (uint32_t l = 0; ok && l < header.numLevels; l++) total += sizes[l];
+    unsigned char* pixels = ok ? (unsigned char*)malloc(total ? total : 1) : NULL;
+    ok = pixels && fread(pixels, 1, total, f) == total;
+    fclose(f);
+    if (!ok) {
+        free(pixels);
+        return 0;
     }
 
-    // Libera as texturas carregadas
-    if (model->textures_loaded) {
-        for (unsigned int i = 0; i < model->num_textures_loaded; i++) {
-            if (model->textures_loaded[i].path) free(model->textures_loaded[i].path);
-            if (model->textures_loaded[i].type) free(model->textures_loaded[i].type);
-        }
-        free(model->textures_loaded);
+    upload->pixels = pixels;
+    upload->width = (int)header.width;
+    upload->height = (int)header.height;
+    upload->channels = (int)header.channels;
+    upload->compressedFormat = header.compressedFormat;
+    upload->numLevels = (int)header.numLevels;
+    for (uint32_t l = 0; l < header.numLevels; l++) upload->levelSize[l] = sizes[l];
+    upload->fromCache = 1;
+    return 1;
+}
+
+// Grava os níveis de upload (comprimidos ou não). Falhas só geram aviso.
+static void textureCacheSave(const TextureUpload* upload) {
+    struct stat st;
+    if (stat(upload->filename, &st) != 0) return;
+
+    char cachePath[1024], tmpPath[1040];
+    textureCachePathFor(upload->filename, cachePath, sizeof(cachePath));
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", cachePath);
+    FILE* f = fopen(tmpPath, "wb");
+    if (!f) { fprintf(stderr, "Aviso: não foi possível gravar %s\n", cachePath); return; }
+
+    TextureCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = TEXTURE_CACHE_VERSION;
+    header.sourceSize = (uint64_t)st.st_size;
+    header.sourceMtime = (int64_t)st.st_mtime;
+    header.width = (uint32_t)upload->width;
+    header.height = (uint32_t)upload->height;
+    header.channels = (uint32_t)upload->channels;
+    header.compressedFormat = upload->compressedFormat;
+    header.numLevels = (uint32_t)upload->numLevels;
+    fwrite(&header, sizeof(header), 1, f);
+    size_t total = 0;
+    for (int l = 0; l < upload->numLevels; l++) {
+        uint32_t size = (uint32_t)upload->levelSize[l];
+        fwrite(&size, sizeof(size), 1, f);
+        total += upload->levelSize[l];
     }
+    fwrite(upload->pixels, 1, total, f);
+
+    int ok = !ferror(f);
+    ok = (fclose(f) == 0) && ok;
+    remove(cachePath); // rename não sobrescreve no Windows
+    if (!ok || rename(tmpPath, cachePath) != 0) {
+        remove(tmpPath);
+        fprintf(stderr, "Aviso: não foi possível gravar %s\n", cachePath);
+        return;
+    }
+    printf("Cache de textura gravado: %s\n", cachePath);
+}
 
-    // Libera o resto
-    if (model->directory) free(model->directory);
-    free(model);
+// Níveis comprimidos lidos de volta do driver: gravados no pool para não travar o quadro
+static void textureCacheSaveJob(void* arg) {
+    TextureUpload* upload = (TextureUpload*)arg;
+    textureCacheSave(upload);
+    free(upload->pixels);
+    free(upload);
 }
 
-unsigned int TextureFromFile(const char* path, const char* directory) {
-    char filename[512];
-    sprintf(filename, "%s/%s", directory, path);
+static void textureDecodeJob(void* arg) {
+    TextureUpload* upload = (TextureUpload*)arg;
+    uint64_t start = Clock_NowNs();
+    if (!textureCacheEnabled || !textureCacheLoad(upload)) {
+        unsigned char* level0 = stbi_load(upload->filename, &upload->width, &upload->height, &upload->channels, 0);
+        if (level0 && !textureBuildLevels(upload, level0)) upload->pixels = NULL;
+        stbi_image_free(level0);
+        // Sem compressão os níveis já são o que vai para o GL; comprimidos, só depois do upload
+        if (upload->pixels && textureCacheEnabled && !textureCompressedFormat(upload->channels)) textureCacheSave(upload);
+    }
+    LoadProfile_Add(upload->profile, LOAD_PHASE_TEXTURE_DECODE, start);
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    pthread_mutex_lock(&textureUploadMutex);
+    upload->next = textureUploadsReady;
+    textureUploadsReady = upload;
+    pthread_mutex_unlock(&textureUploadMutex);
+}
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(filename, &width, &height, &nrComponents, 0);
-    if (data) {
-        GLenum format;
-        if (nrComponents == 1) format = GL_RED;
-        else if (nrComponents == 3) format = GL_RGB;
-        else if (nrComponents == 4) format = GL_RGBA;
-        else format = GL_RGB;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        // Em OpenGL legado, glTexImage2D é suficiente. Mipmaps podem ser gerados por GLU ou desativados.
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        
-        // Configurações de textura mais simples para legado
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        
-        printf("Textura carregada com sucesso: %s\n", filename);
-    } else {
-        fprintf(stderr, "Falha ao carregar textura: %s\n", filename);
+GLuint TextureLoader_Request(const char* filename, LoadProfile* profile) {
+    static const unsigned char placeholder[4] = { 255, 255, 255, 255 };
+
+    // A extensão é consultada aqui (thread do GL), antes do primeiro job de decodificação
+    if (textureCompressionActive < 0) {
+        textureCompressionActive = textureCompression && glHasExtension("GL_EXT_texture_compression_s3tc");
+        if (textureCompression && !textureCompressionActive) {
+            fprintf(stderr, "Aviso: GL_EXT_texture_compression_s3tc indisponível - texturas sem compressão\n");
+        }
     }
-    stbi_image_free(data);
+
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    TextureUpload* upload = (TextureUpload*)calloc(1, sizeof(TextureUpload));
+    upload->id = textureID;
+    upload->profile = profile;
+    strncpy(upload->filename, filename, sizeof(upload->filename) - 1);
+    upload->nextInFlight = textureUploadsInFlight;
+    textureUploadsInFlight = upload;
+    atomic_fetch_add(&texturesPending, 1);
+    JobPool_Submit(textureDecodeJob, upload);
     return textureID;
 }
 
-void loadMaterialTextures(struct aiMaterial* mat, enum aiTextureType type, const char* typeName, Mesh* outMesh, Model* model) {
-    unsigned int texture_count = aiGetMaterialTextureCount(mat, type);
-    if (texture_count == 0) return;
-
-    // Aloca memória para o array de texturas da malha de uma só vez
-    outMesh->textures = (Texture*)malloc(texture_count * sizeof(Texture));
-    outMesh->numTextures = 0; // Usaremos como um contador ao preencher
+// Marca o pedido da textura como cancelado antes de o nome ser apagado: o nome pode
+// voltar em outro glGenTextures, e o upload atrasado não pode cair nessa textura nova.
+// Só na thread do GL.
+void TextureLoader_Cancel(GLuint id) {
+    for (TextureUpload* upload = textureUploadsInFlight; upload; upload = upload->nextInFlight) {
+        if (upload->id == id) upload->cancelled = 1;
+    }
+}
 
-    for (unsigned int i = 0; i < texture_count; i++) {
-        struct aiString str;
-        aiGetMaterialTexture(mat, type, i, &str, NULL, NULL, NULL, NULL, NULL, NULL);
+static void textureUploadFinished(TextureUpload* upload) {
+    TextureUpload** link = &textureUploadsInFlight;
+    while (*link && *link != upload) link = &(*link)->nextInFlight;
+    if (*link) *link = upload->nextInFlight;
+}
 
-        bool skip = false;
-        // Verifica se a textura já foi carregada no modelo
-        for (unsigned int j = 0; j < model->num_textures_loaded; j++) {
-            if (strcmp(model->textures_loaded[j].path, str.data) == 0) {
-                // Se sim, apenas copia a struct, não carrega de novo
-                outMesh->textures[outMesh->numTextures++] = model->textures_loaded[j];
-                skip = true;
-                break;
-            }
+// Envia os níveis para a textura ligada e devolve os bytes que ela ocupa na GPU. Se o
+// driver comprimiu os níveis e o cache está ligado, troca upload->pixels pela versão
+// comprimida para textureCacheSaveJob.
+static size_t textureUploadLevels(TextureUpload* upload, int* saveCompressed) {
+    GLenum format;
+    if (upload->channels == 1) format = GL_LUMINANCE;
+    else if (upload->channels == 2) format = GL_LUMINANCE_ALPHA;
+    else if (upload->channels == 4) format = GL_RGBA;
+    else format = GL_RGB;
+    GLenum compressedFormat = upload->compressedFormat ? upload->compressedFormat : textureCompressedFormat(upload->channels);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // linhas RGB não são múltiplas de 4
+    const unsigned char* level = upload->pixels;
+    for (int l = 0; l < upload->numLevels; l++) {
+        int width = textureLevelDimension(upload->width, l), height = textureLevelDimension(upload->height, l);
+        if (upload->compressedFormat) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, l, upload->compressedFormat, width, height, 0, (GLsizei)upload->levelSize[l], level);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, l, compressedFormat ? compressedFormat : format, width, height, 0, format, GL_UNSIGNED_BYTE, level);
         }
+        level += upload->levelSize[l];
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, upload->numLevels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, upload->numLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+
+    if (!compressedFormat) {
+        size_t bytes = 0;
+        for (int l = 0; l < upload->numLevels; l++) bytes += upload->levelSize[l];
+        return bytes;
+    }
+    // Tamanho real de cada nível comprimido, direto do driver
+    GLint sizes[TEXTURE_MAX_LEVELS];
+    size_t bytes = 0;
+    for (int l = 0; l < upload->numLevels; l++) {
+        sizes[l] = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, l, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &sizes[l]);
+        bytes += (size_t)sizes[l];
+    }
+    *saveCompressed = 0;
+    if (!textureCacheEnabled || upload->compressedFormat) return bytes;
+    unsigned char* compressed = (unsigned char*)malloc(bytes ? bytes : 1);
+    if (!compressed) return bytes;
+    unsigned char* out = compressed;
+    for (int l = 0; l < upload->numLevels; l++) {
+        glGetCompressedTexImage(GL_TEXTURE_2D, l, out);
+        upload->levelSize[l] = (size_t)sizes[l];
+        out += sizes[l];
+    }
+    free(upload->pixels);
+    upload->pixels = compressed;
+    upload->compressedFormat = compressedFormat;
+    *saveCompressed = 1;
+    return bytes;
+}
 
-        if (!skip) {
-            // Se não, é uma nova textura: carrega e adiciona à lista global do modelo
-            Texture texture;
-            texture.id = TextureFromFile(str.data, model->directory);
-            texture.type = (char*)malloc(strlen(typeName) + 1);
-            strcpy(texture.type, typeName);
-            texture.path = (char*)malloc(strlen(str.data) + 1);
-            strcpy(texture.path, str.data);
-            
-            // Adiciona à lista de texturas da malha
-            outMesh->textures[outMesh->numTextures++] = texture;
-
-            // Adiciona à lista global de texturas do modelo 
-            model->num_textures_loaded++;
-            model->textures_loaded = (Texture*)realloc(model->textures_loaded, model->num_textures_loaded * sizeof(Texture));
-            model->textures_loaded[model->num_textures_loaded - 1] = texture;
+// Envia para o GL as imagens já decodificadas. Só na thread do GL.
+void TextureLoader_PumpUploads(void) {
+    pthread_mutex_lock(&textureUploadMutex);
+    TextureUpload* ready = textureUploadsReady;
+    textureUploadsReady = NULL;
+    pthread_mutex_unlock(&textureUploadMutex);
+
+    int uploaded = 0;
+    while (ready) {
+        TextureUpload* upload = ready;
+        ready = ready->next;
+
+        textureUploadFinished(upload);
+
+        int saveCompressed = 0;
+        if (upload->cancelled) {
+            // Textura liberada pelo registro antes de a decodificação terminar
+        } else if (upload->pixels) {
+            uint64_t start = Clock_NowNs();
+            glBindTexture(GL_TEXTURE_2D, upload->id);
+            size_t gpuBytes = textureUploadLevels(upload, &saveCompressed);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            LoadProfile_Add(upload->profile, LOAD_PHASE_GL_UPLOAD, start);
+
+            // Antes: só o nível 0, sem compressão
+            size_t level0Bytes = (size_t)upload->width * upload->height * upload->channels;
+            textureBytesLevel0 += level0Bytes;
+            textureBytesGpu += gpuBytes;
+            textureUploadGeneration++;
+            uploaded = 1;
+            printf("Textura carregada: %s (%dx%d, %d canais)%s: %d níveis, %s, %.1f KB na GPU (antes %.1f KB)\n",
+                   upload->filename, upload->width, upload->height, upload->channels, upload->fromCache ? " do cache" : "",
+                   upload->numLevels, textureFormatName(upload->compressedFormat ? upload->compressedFormat : textureCompressedFormat(upload->channels)),
+                   gpuBytes / 1024.0, level0Bytes / 1024.0);
+        } else {
+            fprintf(stderr, "Falha ao carregar textura: %s\n", upload->filename);
+        }
+        if (saveCompressed) {
+            JobPool_Submit(textureCacheSaveJob, upload);
+        } else {
+            free(upload->pixels);
+            free(upload);
         }
+        atomic_fetch_sub(&texturesPending, 1);
+    }
+    if (uploaded && atomic_load(&texturesPending) == 0) {
+        printf("Texturas na GPU: %.1f MB (só o nível 0, sem compressão: %.1f MB)\n",
+               textureBytesGpu / (1024.0 * 1024.0), textureBytesLevel0 / (1024.0 * 1024.0));
     }
-}
\ No newline at end of file
+}
+
+int TextureLoader_Pending(void) {
+    return atomic_load(&texturesPending);
+}
+
+// Quem guarda algo desenhado com as texturas (o cubemap da sala) compara este número
+// para saber se alguma placeholder foi trocada pela imagem de verdade desde então
+unsigned int TextureLoader_Generation(void) {
+    return textureUploadGeneration;
+}
+
+// ---- Registro global de texturas ----
+// Uma entrada por imagem, indexada pelo hash do caminho resolvido e com contagem de
+// referências: modelos (e as cabeças) que usam a mesma imagem compartilham a textura.
+// Cada Texture resolvida de uma malha segura uma referência. Só na thread do GL.
+
+typedef struct TextureEntry {
+    uint32_t hash;
+    char* path;
+    GLuint id;
+    unsigned int refCount;
+    struct TextureEntry* next;
+} TextureEntry;
+
+#define TEXTURE_REGISTRY_BUCKETS 256
+static TextureEntry* textureRegistry[TEXTURE_REGISTRY_BUCKETS];
+static unsigned int textureRegistryHits = 0;
+static unsigned int textureRegistryLoads = 0;
+
+// Normaliza separadores e remove "./" iniciais para que "./a/b.jpg" e "a\\b.jpg" coincidam
+static void normalizeTexturePath(const char* in, char* out, size_t outSize) {
+    while (in[0] == '.' && (in[1] == '/' || in[1] == '\\')) in += 2;
+    size_t n = 0;
+    for (; *in && n + 1 < outSize; in++) out[n++] = (*in == '\\') ? '/' : *in;
+    out[n] = '\0';
+}
+
+static uint32_t hashTexturePath(const char* s) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (; *s; s++) { h ^= (unsigned char)*s; h *= 16777619u; }
+    return h;
+}
+
+static TextureEntry** textureRegistryFind(const char* normalized, uint32_t hash) {
+    TextureEntry** link = &textureRegistry[hash % TEXTURE_REGISTRY_BUCKETS];
+    while (*link && ((*link)->hash != hash || strcmp((*link)->path, normalized) != 0)) link = &(*link)->next;
+    return link;
+}
+
+Texture TextureRegistry_Acquire(const char* path, const char* typeName, LoadProfile* profile) {
+    char normalized[1024];
+    normalizeTexturePath(path, normalized, sizeof(normalized));
+    uint32_t hash = hashTexturePath(normalized);
+
+    TextureEntry** link = textureRegistryFind(normalized, hash);
+    TextureEntry* entry = *link;
+    if (entry) {
+        textureRegistryHits++;
+    } else {
+        entry = (TextureEntry*)calloc(1, sizeof(TextureEntry));
+        entry->hash = hash;
+        entry->path = (char*)malloc(strlen(normalized) + 1);
+        strcpy(entry->path, normalized);
+        entry->id = TextureLoader_Request(normalized, profile);
+        *link = entry;
+        textureRegistryLoads++;
+    }
+    entry->refCount++;
+
+    Texture texture;
+    texture.id = entry->id;
+    texture.type = typeName;
+    texture.path = entry->path;
+    return texture;
+}
+
+void TextureRegistry_Release(const char* path) {
+    char normalized[1024];
+    normalizeTexturePath(path, normalized, sizeof(normalized));
+    TextureEntry** link = textureRegistryFind(normalized, hashTexturePath(normalized));
+    TextureEntry* entry = *link;
+    if (!entry || --entry->refCount > 0) return;
+
+    *link = entry->next;
+    TextureLoader_Cancel(entry->id);
+    glDeleteTextures(1, &entry->id);
+    free(entry->path);
+    free(entry);
+}
+
+void TextureRegistry_PrintStats(void) {
+    unsigned int live = 0, refs = 0;
+    for (int b = 0; b < TEXTURE_REGISTRY_BUCKETS; b++) {
+        for (TextureEntry* entry = textureRegistry[b]; entry; entry = entry->next) { live++; refs += entry->refCount; }
+    }
+    printf("Registro de texturas: %u imagens carregadas, %u reaproveitadas, %u ativas (%u referências)\n",
+           textureRegistryLoads, textureRegistryHits, live, refs);
+}
+
+// ---- Arena de geometria por modelo ----
+// Os carregadores contam tudo antes de preencher (MeshArenaSizes por malha) e o modelo
+// recebe um bloco só: [Mesh x n][meshDone x n] e, para cada malha na ordem de desenho,
+// [vértices][índices][texturas + caminhos pendentes]. Cada Mesh já sai apontando para as
+// suas fatias, então o preenchimento em paralelo não aloca nada e o Model_Destroy é um free.
+
+typedef struct {
+    unsigned int numVertices;
+    unsigned int numIndices;
+    GLenum indexType;
+    unsigned int numTextures;
+    size_t pathBytes; // caminhos pendentes das texturas, com os '\0'
+    int packed;       // vértices em PackedVertex (--quantize)
+} MeshArenaSizes;
+
+#define MODEL_ARENA_ALIGN 16
+
+static size_t arenaAlign(size_t bytes) {
+    return (bytes + MODEL_ARENA_ALIGN - 1) & ~(size_t)(MODEL_ARENA_ALIGN - 1);
+}
+
+// meshDone NULL: sem flags de streaming (arenas refeitos depois da carga)
+unsigned char* ModelArena_Create(const MeshArenaSizes* sizes, unsigned int count, Mesh** meshes, atomic_uchar** meshDone, size_t* totalBytes) {
+    size_t total = arenaAlign((size_t)count * sizeof(Mesh));
+    if (meshDone) total += arenaAlign((size_t)count * sizeof(atomic_uchar));
+    for (unsigned int i = 0; i < count; i++) {
+        total += arenaAlign((size_t)sizes[i].numVertices * (sizes[i].packed ? sizeof(PackedVertex) : sizeof(Vertex)))
+               + arenaAlign((size_t)sizes[i].numIndices * Mesh_IndexSize(sizes[i].indexType))
+               + arenaAlign(sizes[i].numTextures * sizeof(Texture) + sizes[i].pathBytes);
+    }
+
+    unsigned char* arena = (unsigned char*)malloc(total ? total : 1);
+    unsigned char* cursor = arena;
+    *meshes = (Mesh*)cursor;
+    memset(cursor, 0, (size_t)count * sizeof(Mesh));
+    cursor += arenaAlign((size_t)count * sizeof(Mesh));
+    if (meshDone) {
+        *meshDone = (atomic_uchar*)cursor;
+        for (unsigned int i = 0; i < count; i++) atomic_init(&(*meshDone)[i], 0);
+        cursor += arenaAlign((size_t)count * sizeof(atomic_uchar));
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        Mesh* mesh = &(*meshes)[i];
+        mesh->numVertices = sizes[i].numVertices;
+        mesh->numIndices = sizes[i].numIndices;
+        mesh->indexType = sizes[i].indexType;
+        if (sizes[i].packed) mesh->packedVertices = (PackedVertex*)cursor;
+        else mesh->vertices = (Vertex*)cursor;
+        cursor += arenaAlign((size_t)mesh->numVertices * (sizes[i].packed ? sizeof(PackedVertex) : sizeof(Vertex)));
+        mesh->indices = cursor;
+        cursor += arenaAlign((size_t)mesh->numIndices * Mesh_IndexSize(mesh->indexType));
+        // numTextures começa em 0 e cresce com Mesh_AddPendingTexture (ou cópia direta)
+        if (sizes[i].numTextures > 0) mesh->textures = (Texture*)cursor;
+        cursor += arenaAlign(sizes[i].numTextures * sizeof(Texture) + sizes[i].pathBytes);
+    }
+    *totalBytes = total;
+    return arena;
+}
+
+// Bytes que Mesh_AddPendingTexture vai usar para "prefix/name" (prefix NULL = name já completo)
+static size_t pendingTextureBytes(const char* prefix, size_t nameLength) {
+    return (prefix ? strlen(prefix) + 1 : 0) + nameLength + 1;
+}
+
+// Acrescenta uma textura pendente; o caminho vai para a área logo depois do array de
+// texturas (dimensionado por MeshArenaSizes.numTextures/pathBytes)
+void Mesh_AddPendingTexture(Mesh* mesh, unsigned int capacity, const char* prefix, const char* name, size_t nameLength) {
+    char* path = mesh->numTextures == 0
+        ? (char*)(mesh->textures + capacity)
+        : mesh->textures[mesh->numTextures - 1].path + strlen(mesh->textures[mesh->numTextures - 1].path) + 1;
+    size_t prefixLength = prefix ? (size_t)sprintf(path, "%s/", prefix) : 0;
+    memcpy(path + prefixLength, name, nameLength);
+    path[prefixLength + nameLength] = '\0';
+    Texture* texture = &mesh->textures[mesh->numTextures++];
+    texture->id = 0;
+    texture->type = NULL;
+    texture->path = path;
+}
+
+// ---- Funções de carregamento (refatoradas) ----
+
+// Protótipos para as novas funções (coloque com os outros protótipos se preferir)
+void processNode_pass1_count(struct aiNode* node, const struct aiScene* scene, unsigned int* meshCounter, unsigned int* textureCounter);
+void processNode_pass2_fillData(struct aiNode* node, const struct aiScene* scene, struct aiMesh** meshOrder, unsigned int* mesh_idx_counter);
+void collectMaterialTextures(struct aiMaterial* mat, enum aiTextureType type, const char* directory, Mesh* outMesh);
+void Model_ResolveMeshTextures(Model* model, Mesh* mesh);
+int MeshCache_Load(Model* model, const char* path);
+void MeshCache_Save(const Model* model, const char* path);
+char* ObjLoader_MaterialLibraries(const Model* model, uint32_t* count);
+void Model_FinishLoad(Model* model);
+void Mesh_PrepareForDraw(Mesh* mesh);
+void Mesh_ReleaseGpu(Mesh* mesh);
+void Mesh_ComputeBounds(Mesh* mesh);
+
+// Passa 1: Percorre a cena para contar o total de malhas e texturas únicas
+void processNode_pass1_count(struct aiNode* node, const struct aiScene* scene, unsigned int* meshCounter, unsigned int* textureCounter) {
+    *meshCounter += node->mNumMeshes;
+    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+        struct aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+        if (mesh->mMaterialIndex >= 0) {
+            struct aiMaterial* mat = scene->mMaterials[mesh->mMaterialIndex];
+            *textureCounter += aiGetMaterialTextureCount(mat, aiTextureType_DIFFUSE);
+        }
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        processNode_pass1_count(node->mChildren[i], scene, meshCounter, textureCounter);
+    }
+}
+
+//  Lista as malhas na ordem do grafo de cena; cada uma vira uma tarefa do pool
+void processNode_pass2_fillData(struct aiNode* node, const struct aiScene* scene, struct aiMesh** meshOrder, unsigned int* mesh_idx_counter) {
+    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+        meshOrder[*mesh_idx_counter] = scene->mMeshes[node->mMeshes[i]];
+        (*mesh_idx_counter)++;
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        processNode_pass2_fillData(node->mChildren[i], scene, meshOrder, mesh_idx_counter);
+    }
+}
+
+// Prioridade de carga: alinhamento entre a direção cameraPos -> centro da malha e a
+// direção de visão inicial (1 = bem na frente, -1 = atrás)
+static float meshViewPriority(const Model* model, const float boxMin[3], const float boxMax[3]) {
+    vec3 d;
+    for (int k = 0; k < 3; k++) d[k] = 0.5f * (boxMin[k] + boxMax[k]) - model->loadViewPos[k];
+    float len = glm_vec3_norm(d);
+    if (len < 1e-4f) return 1.0f;
+    return glm_vec3_dot(d, (float*)model->loadViewDir) / len;
+}
+
+typedef struct {
+    unsigned int source; // índice na ordem original (grafo de cena / arquivo de cache)
+    float priority;
+} MeshLoadOrder;
+
+static int compareMeshLoadOrder(const void* a, const void* b) {
+    const MeshLoadOrder* x = (const MeshLoadOrder*)a;
+    const MeshLoadOrder* y = (const MeshLoadOrder*)b;
+    if (x->priority != y->priority) return x->priority > y->priority ? -1 : 1;
+    return (x->source > y->source) - (x->source < y->source);
+}
+
+// Aloca o arena do modelo (malhas já com as fatias apontadas) e publica o total para a
+// thread do GL
+static void modelPublishMeshSlots(Model* model, const MeshArenaSizes* sizes, unsigned int total) {
+    model->arena = ModelArena_Create(sizes, total, &model->meshes, &model->meshDone, &model->arenaBytes);
+    atomic_store(&model->meshesTotal, total);
+}
+
+typedef struct {
+    const struct aiScene* scene;
+    struct aiMesh** meshOrder; // já em ordem de prioridade
+    Model* model;
+} MeshFillJob;
+
+// Tarefa do pool: converte um aiMesh direto nas fatias de arena de model->meshes[index]
+static void processMeshJob(unsigned int index, void* ctx) {
+    MeshFillJob* job = (MeshFillJob*)ctx;
+    processMesh(job->meshOrder[index], job->scene, job->model->directory, &job->model->meshes[index], job->model->profile);
+    atomic_store(&job->model->meshDone[index], 1);
+}
+
+// Troca os caminhos pendentes da malha por texturas do registro.
+// Chamado na thread do GL: é aqui que as texturas novas são criadas.
+void Model_ResolveMeshTextures(Model* model, Mesh* mesh) {
+    for (unsigned int i = 0; i < mesh->numTextures; i++) {
+        // O caminho pendente mora no arena; o registro guarda a sua própria cópia
+        mesh->textures[i] = TextureRegistry_Acquire(mesh->textures[i].path, "texture_diffuse", model->profile);
+    }
+}
+
+// Só coleta os caminhos, já resolvidos contra o diretório do modelo (sem GL):
+// seguro para rodar nas threads do pool. O espaço já foi contado por aiMeshArenaSizes.
+void collectMaterialTextures(struct aiMaterial* mat, enum aiTextureType type, const char* directory, Mesh* outMesh) {
+    unsigned int texture_count_in_mat = aiGetMaterialTextureCount(mat, type);
+    for (unsigned int i = 0; i < texture_count_in_mat; i++) {
+        struct aiString str;
+        aiGetMaterialTexture(mat, type, i, &str, NULL, NULL, NULL, NULL, NULL, NULL);
+        Mesh_AddPendingTexture(outMesh, texture_count_in_mat, directory, str.data, strlen(str.data));
+    }
+}
+
+// Tamanhos de um aiMesh no arena (mesma contagem que processMesh vai preencher)
+static void aiMeshArenaSizes(const struct aiMesh* mesh, const struct aiScene* scene, const char* directory, MeshArenaSizes* out) {
+    memset(out, 0, sizeof(*out));
+    out->numVertices = mesh->mNumVertices;
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) out->numIndices += mesh->mFaces[i].mNumIndices;
+    out->indexType = Mesh_IndexTypeFor(out->numVertices);
+    struct aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+    out->numTextures = aiGetMaterialTextureCount(material, aiTextureType_DIFFUSE);
+    for (unsigned int i = 0; i < out->numTextures; i++) {
+        struct aiString str;
+        aiGetMaterialTexture(material, aiTextureType_DIFFUSE, i, &str, NULL, NULL, NULL, NULL, NULL, NULL);
+        out->pathBytes += pendingTextureBytes(directory, strlen(str.data));
+    }
+}
+
+
+// ---- Cache binário de malhas ----
+// "<modelo>.meshcache" guarda os arrays finais de Vertex/índices, cores difusas e
+// caminhos de textura (já resolvidos). É válido enquanto caminho, tamanho e mtime do fonte
+// e dos .mtl que ele cita (cores e texturas vêm deles) baterem.
+
+#define MESH_CACHE_MAGIC "AAMESH\0"
+#define MESH_CACHE_VERSION 4
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t vertexSize;  // sizeof(Vertex): detecta mudança de layout
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint32_t pathLength;  // seguido pelos bytes do caminho do modelo
+    uint32_t numMeshes;
+    uint32_t numDependencies; // depois do caminho: numDependencies x MeshCacheDependency
+} MeshCacheHeader;
+
+// Arquivo de que o cache depende (.mtl), seguido pelos bytes do caminho
+typedef struct {
+    uint64_t size;
+    int64_t mtime;
+    uint32_t pathLength;
+    uint32_t missing;     // não existia na gravação: aparecer também invalida
+} MeshCacheDependency;
+
+typedef struct {
+    uint32_t numVertices;
+    uint32_t numIndices;
+    uint32_t indexSize;   // 2 ou 4 bytes
+    uint32_t numTextures; // seguido por numTextures x (uint32 tamanho + bytes do caminho)
+    float diffuseColor[3];
+} MeshCacheEntry;
+
+// Arquivo mapeado somente leitura
+typedef struct {
+    const unsigned char* data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} MappedFile;
+
+int MappedFile_Open(MappedFile* mf, const char* path) {
+    memset(mf, 0, sizeof(*mf));
+#ifdef _WIN32
+    mf->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mf->file == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mf->file, &size) || size.QuadPart == 0) { CloseHandle(mf->file); return 0; }
+    mf->mapping = CreateFileMappingA(mf->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mf->mapping) { CloseHandle(mf->file); return 0; }
+    mf->data = (const unsigned char*)MapViewOfFile(mf->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!mf->data) { CloseHandle(mf->mapping); CloseHandle(mf->file); return 0; }
+    mf->size = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) { close(fd); return 0; }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return 0;
+    mf->data = (const unsigned char*)p;
+    mf->size = (size_t)st.st_size;
+#endif
+    return 1;
+}
+
+void MappedFile_Close(MappedFile* mf) {
+    if (!mf->data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(mf->data);
+    CloseHandle(mf->mapping);
+    CloseHandle(mf->file);
+#else
+    munmap((void*)mf->data, mf->size);
+#endif
+    mf->data = NULL;
+}
+
+void MeshCache_PathFor(const char* path, char* out, size_t outSize) {
+    snprintf(out, outSize, "%s.meshcache", path);
+}
+
+// Leitura sequencial com checagem de limites sobre o arquivo mapeado
+static const void* meshCacheTake(const MappedFile* mf, size_t* cursor, size_t bytes) {
+    if (bytes > mf->size - *cursor) return NULL;
+    const void* p = mf->data + *cursor;
+    *cursor += bytes;
+    return p;
+}
+
+// Confere os .mtl gravados no cache contra o disco; 0 se algum mudou, sumiu ou apareceu
+static int meshCacheDependenciesValid(const MappedFile* mf, size_t* cursor, uint32_t count) {
+    for (uint32_t d = 0; d < count; d++) {
+        const MeshCacheDependency* dependency = (const MeshCacheDependency*)meshCacheTake(mf, cursor, sizeof(MeshCacheDependency));
+        const char* bytes = dependency ? (const char*)meshCacheTake(mf, cursor, dependency->pathLength) : NULL;
+        if (!bytes) return 0;
+        char path[1024];
+        snprintf(path, sizeof(path), "%.*s", (int)dependency->pathLength, bytes);
+        struct stat st;
+        int exists = stat(path, &st) == 0;
+        if (exists == (int)dependency->missing) return 0;
+        if (exists && (dependency->size != (uint64_t)st.st_size || dependency->mtime != (int64_t)st.st_mtime)) return 0;
+    }
+    return 1;
+}
+
+// Tenta montar o modelo a partir do cache. Retorna 1 em caso de sucesso.
+// Roda na thread de carga: as malhas são copiadas em ordem de prioridade e publicadas
+// uma a uma; as texturas ficam pendentes para a thread do GL.
+int MeshCache_Load(Model* model, const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+
+    char cachePath[1024];
+    MeshCache_PathFor(path, cachePath, sizeof(cachePath));
+    MappedFile mf;
+    if (!MappedFile_Open(&mf, cachePath)) return 0;
+
+    size_t cursor = 0;
+    const MeshCacheHeader* header = (const MeshCacheHeader*)meshCacheTake(&mf, &cursor, sizeof(MeshCacheHeader));
+    const char* cachedPath = header ? (const char*)meshCacheTake(&mf, &cursor, header->pathLength) : NULL;
+    if (!header || !cachedPath
+        || memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(header->magic)) != 0
+        || header->version != MESH_CACHE_VERSION
+        || header->vertexSize != sizeof(Vertex)
+        || header->sourceSize != (uint64_t)st.st_size
+        || header->sourceMtime != (int64_t)st.st_mtime
+        || header->pathLength != strlen(path)
+        || memcmp(cachedPath, path, header->pathLength) != 0
+        || !meshCacheDependenciesValid(&mf, &cursor, header->numDependencies)) {
+        MappedFile_Close(&mf);
+        return 0;
+    }
+
+    // Primeira varredura: valida o arquivo, guarda onde começa cada malha e calcula a prioridade
+    uint32_t numMeshes = header->numMeshes;
+    size_t* entryOffsets = (size_t*)malloc((numMeshes ? numMeshes : 1) * sizeof(size_t));
+    MeshLoadOrder* order = (MeshLoadOrder*)malloc((numMeshes ? numMeshes : 1) * sizeof(MeshLoadOrder));
+    MeshArenaSizes* sizes = (MeshArenaSizes*)calloc(numMeshes ? numMeshes : 1, sizeof(MeshArenaSizes));
+    size_t scan = cursor;
+    for (uint32_t m = 0; m < numMeshes; m++) {
+        entryOffsets[m] = scan;
+        const MeshCacheEntry* entry = (const MeshCacheEntry*)meshCacheTake(&mf, &scan, sizeof(MeshCacheEntry));
+        int ok = entry && (entry->indexSize == 2 || entry->indexSize == 4);
+        for (uint32_t t = 0; ok && t < entry->numTextures; t++) {
+            const uint32_t* len = (const uint32_t*)meshCacheTake(&mf, &scan, sizeof(uint32_t));
+            ok = len && meshCacheTake(&mf, &scan, *len);
+            if (ok) sizes[m].pathBytes += pendingTextureBytes(NULL, *len);
+        }
+        const Vertex* vertices = ok ? (const Vertex*)meshCacheTake(&mf, &scan, (size_t)entry->numVertices * sizeof(Vertex)) : NULL;
+        if (!vertices || !meshCacheTake(&mf, &scan, (size_t)entry->numIndices * entry->indexSize)) {
+            free(entryOffsets); free(order); free(sizes);
+            MappedFile_Close(&mf);
+            return 0;
+        }
+        sizes[m].numVertices = entry->numVertices;
+        sizes[m].numIndices = entry->numIndices;
+        sizes[m].indexType = entry->indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        sizes[m].numTextures = entry->numTextures;
+
+        vec3 boxMin = { 0.0f, 0.0f, 0.0f }, boxMax = { 0.0f, 0.0f, 0.0f };
+        for (uint32_t v = 0; v < entry->numVertices; v++) {
+            if (v == 0) { glm_vec3_copy((float*)vertices[0].position, boxMin); glm_vec3_copy((float*)vertices[0].position, boxMax); }
+            glm_vec3_minv(boxMin, (float*)vertices[v].position, boxMin);
+            glm_vec3_maxv(boxMax, (float*)vertices[v].position, boxMax);
+        }
+        order[m].source = m;
+        order[m].priority = meshViewPriority(model, boxMin, boxMax);
+    }
+    qsort(order, numMeshes, sizeof(MeshLoadOrder), compareMeshLoadOrder);
+
+    MeshArenaSizes* sortedSizes = (MeshArenaSizes*)malloc((numMeshes ? numMeshes : 1) * sizeof(MeshArenaSizes));
+    for (uint32_t m = 0; m < numMeshes; m++) sortedSizes[m] = sizes[order[m].source];
+    modelPublishMeshSlots(model, sortedSizes, numMeshes);
+    free(sortedSizes);
+    free(sizes);
+    for (uint32_t m = 0; m < numMeshes; m++) {
+        cursor = entryOffsets[order[m].source];
+        const MeshCacheEntry* entry = (const MeshCacheEntry*)meshCacheTake(&mf, &cursor, sizeof(MeshCacheEntry));
+        Mesh* mesh = &model->meshes[m];
+        memcpy(mesh->diffuseColor, entry->diffuseColor, sizeof(mesh->diffuseColor));
+
+        for (uint32_t t = 0; t < entry->numTextures; t++) {
+            uint32_t len = *(const uint32_t*)meshCacheTake(&mf, &cursor, sizeof(uint32_t));
+            Mesh_AddPendingTexture(mesh, entry->numTextures, NULL, (const char*)meshCacheTake(&mf, &cursor, len), len);
+        }
+
+        size_t vbytes = (size_t)mesh->numVertices * sizeof(Vertex);
+        size_t ibytes = (size_t)mesh->numIndices * entry->indexSize;
+        memcpy(mesh->vertices, meshCacheTake(&mf, &cursor, vbytes), vbytes);
+        memcpy(mesh->indices, meshCacheTake(&mf, &cursor, ibytes), ibytes);
+        Mesh_ComputeBounds(mesh);
+        atomic_store(&model->meshDone[m], 1);
+    }
+
+    free(entryOffsets);
+    free(order);
+    MappedFile_Close(&mf);
+    return 1;
+}
+
+// Grava o cache do modelo recém-importado. Falhas só geram aviso.
+// Roda na thread de carga, antes de publicar cpuState: a thread do GL já pode estar
+// trocando textures[t] por texturas do registro, então os caminhos são lidos da área
+// de pendentes do arena (que ninguém altera depois do import).
+void MeshCache_Save(const Model* model, const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return;
+
+    char cachePath[1024], tmpPath[1040];
+    MeshCache_PathFor(path, cachePath, sizeof(cachePath));
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", cachePath);
+    FILE* f = fopen(tmpPath, "wb");
+    if (!f) { fprintf(stderr, "Aviso: não foi possível gravar %s\n", cachePath); return; }
+
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.sourceSize = (uint64_t)st.st_size;
+    header.sourceMtime = (int64_t)st.st_mtime;
+    header.pathLength = (uint32_t)strlen(path);
+    header.numMeshes = atomic_load(&model->meshesTotal);
+    char* libraries = ObjLoader_MaterialLibraries(model, &header.numDependencies);
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(path, 1, header.pathLength, f);
+
+    const char* library = libraries;
+    for (uint32_t d = 0; d < header.numDependencies; d++) {
+        MeshCacheDependency dependency;
+        memset(&dependency, 0, sizeof(dependency));
+        dependency.pathLength = (uint32_t)strlen(library);
+        struct stat libraryStat;
+        if (stat(library, &libraryStat) == 0) {
+            dependency.size = (uint64_t)libraryStat.st_size;
+            dependency.mtime = (int64_t)libraryStat.st_mtime;
+        } else {
+            dependency.missing = 1;
+        }
+        fwrite(&dependency, sizeof(dependency), 1, f);
+        fwrite(library, 1, dependency.pathLength, f);
+        library += dependency.pathLength + 1;
+    }
+    free(libraries);
+
+    for (unsigned int m = 0; m < header.numMeshes; m++) {
+        const Mesh* mesh = &model->meshes[m];
+        MeshCacheEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.numVertices = mesh->numVertices;
+        entry.numIndices = mesh->numIndices;
+        entry.indexSize = Mesh_IndexSize(mesh->indexType);
+        entry.numTextures = mesh->numTextures;
+        memcpy(entry.diffuseColor, mesh->diffuseColor, sizeof(entry.diffuseColor));
+        fwrite(&entry, sizeof(entry), 1, f);
+        const char* texturePath = (const char*)(mesh->textures + mesh->numTextures);
+        for (unsigned int t = 0; t < mesh->numTextures; t++) {
+            uint32_t len = (uint32_t)strlen(texturePath);
+            fwrite(&len, sizeof(len), 1, f);
+            fwrite(texturePath, 1, len, f);
+            texturePath += len + 1;
+        }
+        fwrite(mesh->vertices, sizeof(Vertex), mesh->numVertices, f);
+        fwrite(mesh->indices, entry.indexSize, mesh->numIndices, f);
+    }
+
+    int ok = !ferror(f);
+    ok = (fclose(f) == 0) && ok;
+    remove(cachePath); // rename não sobrescreve no Windows
+    if (!ok || rename(tmpPath, cachePath) != 0) {
+        remove(tmpPath);
+        fprintf(stderr, "Aviso: não foi possível gravar %s\n", cachePath);
+        return;
+    }
+    printf("Cache de malhas gravado: %s\n", cachePath);
+}
+
+
+// ---- Leitor nativo de OBJ/MTL ----
+// Caminho rápido para os .obj exportados pelo Blender/ZBrush. O arquivo é mapeado na
+// memória e quebrado em pedaços em fronteiras de linha. Cada pedaço é lido por uma
+// thread do pool em duas passadas: a primeira só conta v/vt/vn (as somas de prefixo dão
+// a base global de cada pedaço, o que resolve índices negativos sem sincronização) e a
+// segunda converte os números. A saída imita o assimp com aiProcess_Triangulate |
+// aiProcess_FlipUVs: uma malha por objeto/grupo e material, um vértice por canto de face.
+// Qualquer coisa fora do esperado faz o carregamento voltar para o assimp.
+
+int nativeObjLoader = 1; // --assimp-obj desliga
+
+#define OBJ_MIN_CHUNK_BYTES (256 * 1024)
+#define OBJ_DEFAULT_DIFFUSE 0.6f // cor do material padrão do assimp
+
+typedef struct {
+    char* name;
+    vec3 diffuse;
+    char* texture; // map_Kd como escrito no .mtl (relativo ao diretório do modelo)
+} ObjMaterial;
+
+typedef enum { OBJ_EVENT_OBJECT, OBJ_EVENT_GROUP, OBJ_EVENT_MATERIAL, OBJ_EVENT_MTLLIB } ObjEventKind;
+
+// Mudança de estado (o/g/usemtl/mtllib) que vale a partir da face 'face' do pedaço
+typedef struct {
+    uint32_t face;
+    ObjEventKind kind;
+    const char* name;
+    uint32_t nameLength;
+} ObjEvent;
+
+typedef struct {
+    int32_t v, t, n; // índices globais base 0 (-1 = ausente)
+} ObjCorner;
+
+typedef struct {
+    const char* begin;
+    const char* end;
+    // passada 0: contagens e bases globais
+    uint32_t numPositions, numTexCoords, numNormals, numFaceLines;
+    uint32_t basePosition, baseTexCoord, baseNormal;
+    // passada 1: cantos, início de cada face (faceStart[numFaces] = numCorners) e eventos
+    ObjCorner* corners;
+    uint32_t numCorners, capCorners;
+    uint32_t* faceStart;
+    uint32_t numFaces, capFaces;
+    ObjEvent* events;
+    uint32_t numEvents, capEvents;
+    int failed;
+} ObjChunk;
+
+// Série contínua de faces de uma malha dentro de um pedaço
+typedef struct {
+    uint32_t chunk, firstFace, endFace;
+} ObjSpan;
+
+typedef struct {
+    uint32_t firstSpan, numSpans;
+    int32_t material; // -1 = material padrão
+    uint32_t numCorners, numFaces;
+    vec3 boxMin, boxMax;
+} ObjMeshDesc;
+
+typedef struct {
+    Model* model;
+    float* positions;
+    float* texCoords;
+    float* normals;
+    uint32_t numPositions, numTexCoords, numNormals;
+    ObjChunk* chunks;
+    uint32_t numChunks;
+    ObjSpan* spans;
+    uint32_t numSpans, capSpans;
+    ObjMeshDesc* meshes;
+    uint32_t numMeshes, capMeshes;
+    ObjMaterial* materials;
+    uint32_t numMaterials, capMaterials;
+    uint32_t* meshOrder; // ordem de prioridade -> índice em meshes
+} ObjScene;
+
+static void* objGrow(void* data, uint32_t* cap, uint32_t need, size_t elemSize) {
+    if (need <= *cap) return data;
+    uint32_t newCap = *cap ? *cap : 64;
+    while (newCap < need) newCap *= 2;
+    *cap = newCap;
+    return realloc(data, (size_t)newCap * elemSize);
+}
+
+// Próximo '\n' a partir de p (ou end). Com SSE2 compara 16 bytes por vez.
+static const char* objFindNewline(const char* p, const char* end) {
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), newline));
+        if (mask) return p + __builtin_ctz((unsigned int)mask);
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '\n') p++;
+    return p;
+}
+
+static inline int objIsSpace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+static const char* objSkipSpaces(const char* p, const char* end) {
+    while (p < end && objIsSpace(*p)) p++;
+    return p;
+}
+
+// Resto da linha sem espaços nas pontas (nomes com espaço, como "pop base", ficam inteiros)
+static const char* objRestOfLine(const char* p, const char* end, uint32_t* length) {
+    p = objSkipSpaces(p, end);
+    while (end > p && (objIsSpace(end[-1]) || end[-1] == '\r' || end[-1] == '\0')) end--;
+    *length = (uint32_t)(end - p);
+    return p;
+}
+
+// Palavra-chave seguida de espaço (ou fim de linha) no começo da linha
+static int objKeyword(const char* p, const char* end, const char* keyword, size_t length) {
+    return (size_t)(end - p) >= length && memcmp(p, keyword, length) == 0
+        && (p + length == end || objIsSpace(p[length]));
+}
+
+static const double objPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Decimal simples ([-]123.456[e-7]): mantissa inteira de até 19 dígitos e uma única
+// multiplicação/divisão por potência de 10. Retorna NULL se não houver número.
+static const char* objParseFloat(const char* p, const char* end, float* out) {
+    p = objSkipSpaces(p, end);
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) { negative = *p == '-'; p++; }
+
+    uint64_t mantissa = 0;
+    int exponent = 0, digits = 0, sawDigit = 0;
+    while (p < end && (unsigned)(*p - '0') < 10) {
+        if (digits < 19) { mantissa = mantissa * 10 + (uint64_t)(*p - '0'); if (mantissa) digits++; }
+        else exponent++;
+        sawDigit = 1;
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && (unsigned)(*p - '0') < 10) {
+            if (digits < 19) { mantissa = mantissa * 10 + (uint64_t)(*p - '0'); if (mantissa) digits++; exponent--; }
+            sawDigit = 1;
+            p++;
+        }
+    }
+    if (!sawDigit) return NULL;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        int expNegative = 0, expValue = 0, expDigits = 0;
+        if (p < end && (*p == '-' || *p == '+')) { expNegative = *p == '-'; p++; }
+        while (p < end && (unsigned)(*p - '0') < 10) { if (expValue < 10000) expValue = expValue * 10 + (*p - '0'); expDigits++; p++; }
+        if (!expDigits) return NULL;
+        exponent += expNegative ? -expValue : expValue;
+    }
+
+    double value = (double)mantissa;
+    if (exponent < 0) value = exponent >= -22 ? value / objPow10[-exponent] : value * pow(10.0, exponent);
+    else if (exponent > 0) value = exponent <= 22 ? value * objPow10[exponent] : value * pow(10.0, exponent);
+    *out = (float)(negative ? -value : value);
+    return p;
+}
+
+// Índice de face (base 1, negativo = relativo ao último lido) -> índice global base 0
+static const char* objParseIndex(const char* p, const char* end, uint32_t seen, uint32_t total, int32_t* out) {
+    int negative = 0;
+    if (p < end && *p == '-') { negative = 1; p++; }
+    int64_t value = 0;
+    const char* digits = p;
+    while (p < end && (unsigned)(*p - '0') < 10) { if (value <= INT32_MAX) value = value * 10 + (*p - '0'); p++; }
+    if (p == digits || value == 0) return NULL;
+    int64_t index = negative ? (int64_t)seen - value : value - 1;
+    if (index < 0 || index >= (int64_t)total) return NULL;
+    *out = (int32_t)index;
+    return p;
+}
+
+// Passada 0: conta v/vt/vn/f do pedaço
+static void objCountChunk(unsigned int index, void* ctx) {
+    ObjChunk* chunk = &((ObjScene*)ctx)->chunks[index];
+    const char* p = chunk->begin;
+    while (p < chunk->end) {
+        const char* lineEnd = objFindNewline(p, chunk->end);
+        const char* q = objSkipSpaces(p, lineEnd);
+        if (lineEnd - q >= 2) {
+            if (q[0] == 'v') {
+                if (objIsSpace(q[1])) chunk->numPositions++;
+                else if (q[1] == 't' && lineEnd - q >= 3 && objIsSpace(q[2])) chunk->numTexCoords++;
+                else if (q[1] == 'n' && lineEnd - q >= 3 && objIsSpace(q[2])) chunk->numNormals++;
+            } else if (q[0] == 'f' && objIsSpace(q[1])) {
+                chunk->numFaceLines++;
+            }
+        }
+        p = lineEnd + 1;
+    }
+}
+
+static void objPushEvent(ObjChunk* chunk, ObjEventKind kind, const char* p, const char* end) {
+    chunk->events = (ObjEvent*)objGrow(chunk->events, &chunk->capEvents, chunk->numEvents + 1, sizeof(ObjEvent));
+    ObjEvent* event = &chunk->events[chunk->numEvents++];
+    event->face = chunk->numFaces;
+    event->kind = kind;
+    event->name = objRestOfLine(p, end, &event->nameLength);
+}
+
+// Passada 1: converte o pedaço. Os atributos vão direto para os arrays globais, a partir
+// da base do pedaço; faces e eventos ficam no pedaço para a montagem das malhas.
+static void objParseChunk(unsigned int index, void* ctx) {
+    ObjScene* scene = (ObjScene*)ctx;
+    ObjChunk* chunk = &scene->chunks[index];
+    uint32_t position = chunk->basePosition, texCoord = chunk->baseTexCoord, normal = chunk->baseNormal;
+    chunk->capFaces = chunk->numFaceLines + 1;
+    chunk->faceStart = (uint32_t*)malloc(chunk->capFaces * sizeof(uint32_t));
+    chunk->corners = (ObjCorner*)objGrow(NULL, &chunk->capCorners, chunk->numFaceLines * 3 + 1, sizeof(ObjCorner));
+
+    const char* p = chunk->begin;
+    while (p < chunk->end && !chunk->failed) {
+        const char* lineEnd = objFindNewline(p, chunk->end);
+        const char* end = lineEnd;
+        if (end > p && end[-1] == '\r') end--;
+        const char* q = objSkipSpaces(p, end);
+        p = lineEnd + 1;
+        if (end - q < 2) continue;
+
+        if (q[0] == 'v' && objIsSpace(q[1])) {
+            float* out = &scene->positions[(size_t)position++ * 3];
+            q += 2;
+            for (int k = 0; k < 3 && q; k++) q = objParseFloat(q, end, &out[k]);
+            if (!q) chunk->failed = 1;
+        } else if (q[0] == 'v' && q[1] == 't' && end - q >= 3 && objIsSpace(q[2])) {
+            float* out = &scene->texCoords[(size_t)texCoord++ * 2];
+            q = objParseFloat(q + 3, end, &out[0]);
+            if (!q) { chunk->failed = 1; continue; }
+            if (!objParseFloat(q, end, &out[1])) out[1] = 0.0f;
+        } else if (q[0] == 'v' && q[1] == 'n' && end - q >= 3 && objIsSpace(q[2])) {
+            float* out = &scene->normals[(size_t)normal++ * 3];
+            q += 3;
+            for (int k = 0; k < 3 && q; k++) q = objParseFloat(q, end, &out[k]);
+            if (!q) chunk->failed = 1;
+        } else if (q[0] == 'f' && objIsSpace(q[1])) {
+            uint32_t first = chunk->numCorners;
+            q = objSkipSpaces(q + 2, end);
+            while (q < end && *q != '\0') {
+                ObjCorner corner = { -1, -1, -1 };
+                q = objParseIndex(q, end, position, scene->numPositions, &corner.v);
+                if (q && q < end && *q == '/') {
+                    q++;
+                    if (q < end && *q != '/') q = objParseIndex(q, end, texCoord, scene->numTexCoords, &corner.t);
+                    if (q && q < end && *q == '/') q = objParseIndex(q + 1, end, normal, scene->numNormals, &corner.n);
+                }
+                if (!q || (q < end && !objIsSpace(*q) && *q != '\0')) { chunk->failed = 1; break; }
+                chunk->corners = (ObjCorner*)objGrow(chunk->corners, &chunk->capCorners, chunk->numCorners + 1, sizeof(ObjCorner));
+                chunk->corners[chunk->numCorners++] = corner;
+                q = objSkipSpaces(q, end);
+            }
+            // Pontos e linhas soltos não viram triângulos: ficam de fora
+            if (chunk->numCorners - first < 3) chunk->numCorners = first;
+            else chunk->faceStart[chunk->numFaces++] = first;
+        } else if ((q[0] == 'o' || q[0] == 'g') && objIsSpace(q[1])) {
+            objPushEvent(chunk, q[0] == 'o' ? OBJ_EVENT_OBJECT : OBJ_EVENT_GROUP, q + 2, end);
+        } else if (objKeyword(q, end, "usemtl", 6)) {
+            objPushEvent(chunk, OBJ_EVENT_MATERIAL, q + 6, end);
+        } else if (objKeyword(q, end, "mtllib", 6)) {
+            objPushEvent(chunk, OBJ_EVENT_MTLLIB, q + 6, end);
+        }
+    }
+    chunk->faceStart[chunk->numFaces] = chunk->numCorners;
+}
+
+static ObjMaterial* objAddMaterial(ObjScene* scene, const char* name, uint32_t length) {
+    scene->materials = (ObjMaterial*)objGrow(scene->materials, &scene->capMaterials, scene->numMaterials + 1, sizeof(ObjMaterial));
+    ObjMaterial* material = &scene->materials[scene->numMaterials++];
+    material->name = (char*)malloc(length + 1);
+    memcpy(material->name, name, length);
+    material->name[length] = '\0';
+    glm_vec3_fill(material->diffuse, OBJ_DEFAULT_DIFFUSE);
+    material->texture = NULL;
+    return material;
+}
+
+// Só newmtl/Kd/map_Kd importam para o renderizador
+static void objLoadMtl(ObjScene* scene, const char* name, uint32_t length) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%.*s", scene->model->directory, (int)length, name);
+    MappedFile mf;
+    if (!MappedFile_Open(&mf, path)) {
+        fprintf(stderr, "Aviso: material '%s' não encontrado\n", path);
+        return;
+    }
+
+    ObjMaterial* material = NULL;
+    const char* p = (const char*)mf.data;
+    const char* fileEnd = p + mf.size;
+    while (p < fileEnd) {
+        const char* lineEnd = objFindNewline(p, fileEnd);
+        const char* q = objSkipSpaces(p, lineEnd);
+        uint32_t restLength;
+        if (objKeyword(q, lineEnd, "newmtl", 6)) {
+            const char* rest = objRestOfLine(q + 6, lineEnd, &restLength);
+            material = objAddMaterial(scene, rest, restLength);
+        } else if (material && objKeyword(q, lineEnd, "Kd", 2)) {
+            q += 2;
+            for (int k = 0; k < 3 && q; k++) q = objParseFloat(q, lineEnd, &material->diffuse[k]);
+        } else if (material && objKeyword(q, lineEnd, "map_Kd", 6)) {
+            const char* rest = objRestOfLine(q + 6, lineEnd, &restLength);
+            // Opções (-bm 1 ...) antes do arquivo: fica só com a última palavra
+            if (restLength > 0 && rest[0] == '-') {
+                const char* last = rest + restLength;
+                while (last > rest && !objIsSpace(last[-1])) last--;
+                restLength -= (uint32_t)(last - rest);
+                rest = last;
+            }
+            free(material->texture);
+            material->texture = (char*)malloc(restLength + 1);
+            memcpy(material->texture, rest, restLength);
+            material->texture[restLength] = '\0';
+        }
+        p = lineEnd + 1;
+    }
+    MappedFile_Close(&mf);
+}
+
+static int32_t objFindMaterial(ObjScene* scene, const char* name, uint32_t length) {
+    for (uint32_t i = 0; i < scene->numMaterials; i++) {
+        if (strlen(scene->materials[i].name) == length && memcmp(scene->materials[i].name, name, length) == 0) return (int32_t)i;
+    }
+    // Como o assimp: material desconhecido vira um material novo com a cor padrão
+    objAddMaterial(scene, name, length);
+    return (int32_t)scene->numMaterials - 1;
+}
+
+// Acrescenta faces à malha aberta (ou abre uma). *current sempre aponta para a última
+// malha de scene->meshes, então continua válido depois do realloc.
+static void objAppendFaces(ObjScene* scene, ObjMeshDesc** current, int32_t material, uint32_t chunkIndex, uint32_t firstFace, uint32_t endFace) {
+    if (firstFace >= endFace) return;
+    const ObjChunk* chunk = &scene->chunks[chunkIndex];
+    if (!*current) {
+        scene->meshes = (ObjMeshDesc*)objGrow(scene->meshes, &scene->capMeshes, scene->numMeshes + 1, sizeof(ObjMeshDesc));
+        *current = &scene->meshes[scene->numMeshes++];
+        memset(*current, 0, sizeof(ObjMeshDesc));
+        (*current)->firstSpan = scene->numSpans;
+        (*current)->material = material;
+    }
+    scene->spans = (ObjSpan*)objGrow(scene->spans, &scene->capSpans, scene->numSpans + 1, sizeof(ObjSpan));
+    ObjSpan* span = &scene->spans[scene->numSpans++];
+    span->chunk = chunkIndex;
+    span->firstFace = firstFace;
+    span->endFace = endFace;
+    (*current)->numSpans++;
+    (*current)->numFaces += endFace - firstFace;
+    (*current)->numCorners += chunk->faceStart[endFace] - chunk->faceStart[firstFace];
+}
+
+// Passada 2 (serial e barata): percorre os eventos em ordem e recorta as faces em malhas.
+// Regras do importador do assimp: o/g abrem um objeto novo (g só se o nome mudar),
+// usemtl abre uma malha nova se a atual já tem faces e o material do objeto persiste.
+static void objBuildMeshes(ObjScene* scene) {
+    ObjMeshDesc* current = NULL;
+    int32_t material = -1;
+    int materialSet = 0;
+    const char* groupName = NULL;
+    uint32_t groupLength = 0;
+
+    for (uint32_t c = 0; c < scene->numChunks; c++) {
+        ObjChunk* chunk = &scene->chunks[c];
+        uint32_t face = 0;
+        for (uint32_t e = 0; e < chunk->numEvents; e++) {
+            const ObjEvent* event = &chunk->events[e];
+            objAppendFaces(scene, &current, material, c, face, event->face);
+            face = event->face;
+
+            switch (event->kind) {
+            case OBJ_EVENT_OBJECT:
+                current = NULL;
+                groupName = NULL;
+                break;
+            case OBJ_EVENT_GROUP:
+                if (!groupName || groupLength != event->nameLength || memcmp(groupName, event->name, groupLength) != 0) current = NULL;
+                groupName = event->name;
+                groupLength = event->nameLength;
+                break;
+            case OBJ_EVENT_MATERIAL: {
+                int32_t next = objFindMaterial(scene, event->name, event->nameLength);
+                if (!materialSet && current) current->material = next; // faces sem usemtl antes herdam
+                else if (next != material) current = NULL;
+                material = next;
+                materialSet = 1;
+                break;
+            }
+            case OBJ_EVENT_MTLLIB:
+                objLoadMtl(scene, event->name, event->nameLength);
+                break;
+            }
+        }
+        objAppendFaces(scene, &current, material, c, face, chunk->numFaces);
+    }
+}
+
+// Caixa envolvente de cada malha, para a ordem de prioridade do streaming
+static void objBoundsJob(unsigned int index, void* ctx) {
+    ObjScene* scene = (ObjScene*)ctx;
+    ObjMeshDesc* desc = &scene->meshes[index];
+    int first = 1;
+    for (uint32_t s = 0; s < desc->numSpans; s++) {
+        const ObjSpan* span = &scene->spans[desc->firstSpan + s];
+        const ObjChunk* chunk = &scene->chunks[span->chunk];
+        for (uint32_t k = chunk->faceStart[span->firstFace]; k < chunk->faceStart[span->endFace]; k++) {
+            float* p = &scene->positions[(size_t)chunk->corners[k].v * 3];
+            if (first) { glm_vec3_copy(p, desc->boxMin); glm_vec3_copy(p, desc->boxMax); first = 0; }
+            glm_vec3_minv(desc->boxMin, p, desc->boxMin);
+            glm_vec3_maxv(desc->boxMax, p, desc->boxMax);
+        }
+    }
+}
+
+// Quadrilátero como no aiProcess_Triangulate: começa pelo vértice côncavo, se houver
+static unsigned int objQuadStart(const Vertex* v) {
+    for (unsigned int i = 0; i < 4; i++) {
+        vec3 left, diag, right;
+        glm_vec3_sub((float*)v[(i + 3) % 4].position, (float*)v[i].position, left);
+        glm_vec3_sub((float*)v[(i + 2) % 4].position, (float*)v[i].position, diag);
+        glm_vec3_sub((float*)v[(i + 1) % 4].position, (float*)v[i].position, right);
+        glm_vec3_normalize(left); glm_vec3_normalize(diag); glm_vec3_normalize(right);
+        float angle = acosf(glm_clamp(glm_vec3_dot(left, diag), -1.0f, 1.0f)) + acosf(glm_clamp(glm_vec3_dot(right, diag), -1.0f, 1.0f));
+        if (angle > (float)GLM_PI) return i;
+    }
+    return 0;
+}
+
+// Polígono com mais de 4 lados: ear clipping no plano dominante (normal de Newell).
+// Escreve n - 2 triângulos em out (índices locais) preservando a orientação da face.
+static void objTriangulatePolygon(const Vertex* v, unsigned int n, unsigned int* out) {
+    vec3 normal = { 0.0f, 0.0f, 0.0f };
+    for (unsigned int i = 0; i < n; i++) {
+        const float* a = v[i].position;
+        const float* b = v[(i + 1) % n].position;
+        normal[0] += (a[1] - b[1]) * (a[2] + b[2]);
+        normal[1] += (a[2] - b[2]) * (a[0] + b[0]);
+        normal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+    }
+    int axis = fabsf(normal[0]) > fabsf(normal[1]) ? 0 : 1;
+    if (fabsf(normal[2]) > fabsf(normal[axis])) axis = 2;
+    int ax = (axis + 1) % 3, ay = (axis + 2) % 3;
+    float orientation = normal[axis] < 0.0f ? -1.0f : 1.0f;
+
+    unsigned int stackRemaining[64];
+    unsigned int* remaining = n <= 64 ? stackRemaining : (unsigned int*)malloc(n * sizeof(unsigned int));
+    for (unsigned int i = 0; i < n; i++) remaining[i] = i;
+    unsigned int m = n, written = 0;
+
+    while (m > 3) {
+        int clipped = 0;
+        for (unsigned int i = 0; i < m && !clipped; i++) {
+            unsigned int ip = remaining[(i + m - 1) % m], ic = remaining[i], in = remaining[(i + 1) % m];
+            const float* a = v[ip].position;
+            const float* b = v[ic].position;
+            const float* c = v[in].position;
+            float cross = (b[ax] - a[ax]) * (c[ay] - b[ay]) - (b[ay] - a[ay]) * (c[ax] - b[ax]);
+            if (cross * orientation <= 0.0f) continue; // vértice reflexo (ou degenerado)
+
+            int inside = 0;
+            for (unsigned int j = 0; j < m && !inside; j++) {
+                unsigned int ij = remaining[j];
+                if (ij == ip || ij == ic || ij == in) continue;
+                const float* p = v[ij].position;
+                float d0 = ((b[ax] - a[ax]) * (p[ay] - a[ay]) - (b[ay] - a[ay]) * (p[ax] - a[ax])) * orientation;
+                float d1 = ((c[ax] - b[ax]) * (p[ay] - b[ay]) - (c[ay] - b[ay]) * (p[ax] - b[ax])) * orientation;
+                float d2 = ((a[ax] - c[ax]) * (p[ay] - c[ay]) - (a[ay] - c[ay]) * (p[ax] - c[ax])) * orientation;
+                inside = d0 > 0.0f && d1 > 0.0f && d2 > 0.0f;
+            }
+            if (inside) continue;
+
+            out[written++] = ip; out[written++] = ic; out[written++] = in;
+            memmove(&remaining[i], &remaining[i + 1], (m - i - 1) * sizeof(unsigned int));
+            m--;
+            clipped = 1;
+        }
+        // Polígono degenerado/auto-intersectante: termina em leque
+        if (!clipped) {
+            for (unsigned int i = 1; i + 1 < m; i++) { out[written++] = remaining[0]; out[written++] = remaining[i]; out[written++] = remaining[i + 1]; }
+            m = 2;
+        }
+    }
+    if (m == 3) { out[written++] = remaining[0]; out[written++] = remaining[1]; out[written++] = remaining[2]; }
+    if (remaining != stackRemaining) free(remaining);
+}
+
+// Passada 3: monta uma malha (vértices por canto, triângulos, material) no slot 'index'
+static void objFillMeshJob(unsigned int index, void* ctx) {
+    ObjScene* scene = (ObjScene*)ctx;
+    const ObjMeshDesc* desc = &scene->meshes[scene->meshOrder[index]];
+    LoadProfile* profile = scene->model->profile;
+    Mesh* mesh = &scene->model->meshes[index]; // fatias já apontadas no arena
+
+    uint64_t start_step = Clock_NowNs();
+    Vertex* out = mesh->vertices;
+    for (uint32_t s = 0; s < desc->numSpans; s++) {
+        const ObjSpan* span = &scene->spans[desc->firstSpan + s];
+        const ObjChunk* chunk = &scene->chunks[span->chunk];
+        for (uint32_t k = chunk->faceStart[span->firstFace]; k < chunk->faceStart[span->endFace]; k++, out++) {
+            const ObjCorner* corner = &chunk->corners[k];
+            memcpy(out->position, &scene->positions[(size_t)corner->v * 3], sizeof(vec3));
+            if (corner->n >= 0) memcpy(out->normal, &scene->normals[(size_t)corner->n * 3], sizeof(vec3));
+            else glm_vec3_zero(out->normal);
+            if (corner->t >= 0) { out->texCoords[0] = scene->texCoords[(size_t)corner->t * 2]; out->texCoords[1] = 1.0f - scene->texCoords[(size_t)corner->t * 2 + 1]; }
+            else glm_vec2_zero(out->texCoords);
+        }
+    }
+    LoadProfile_Add(profile, LOAD_PHASE_VERTEX_COPY, start_step);
+
+    start_step = Clock_NowNs();
+    unsigned int written = 0, base = 0;
+    unsigned int* polygon = NULL;
+    unsigned int polygonCap = 0;
+    for (uint32_t s = 0; s < desc->numSpans; s++) {
+        const ObjSpan* span = &scene->spans[desc->firstSpan + s];
+        const ObjChunk* chunk = &scene->chunks[span->chunk];
+        for (uint32_t f = span->firstFace; f < span->endFace; f++) {
+            unsigned int n = chunk->faceStart[f + 1] - chunk->faceStart[f];
+            if (n == 3) {
+                for (unsigned int k = 0; k < 3; k++) Mesh_SetIndex(mesh, written++, base + k);
+            } else if (n == 4) {
+                unsigned int s0 = objQuadStart(&mesh->vertices[base]);
+                static const unsigned int quad[6] = { 0, 1, 2, 0, 2, 3 };
+                for (unsigned int k = 0; k < 6; k++) Mesh_SetIndex(mesh, written++, base + (s0 + quad[k]) % 4);
+            } else {
+                if (polygonCap < 3 * (n - 2)) {
+                    polygonCap = 3 * (n - 2);
+                    polygon = (unsigned int*)realloc(polygon, polygonCap * sizeof(unsigned int));
+                }
+                objTriangulatePolygon(&mesh->vertices[base], n, polygon);
+                for (unsigned int k = 0; k < 3 * (n - 2); k++) Mesh_SetIndex(mesh, written++, base + polygon[k]);
+            }
+            base += n;
+        }
+    }
+    free(polygon);
+    LoadProfile_Add(profile, LOAD_PHASE_INDEX_FLATTEN, start_step);
+
+    start_step = Clock_NowNs();
+    const ObjMaterial* material = desc->material >= 0 ? &scene->materials[desc->material] : NULL;
+    if (material && material->texture) {
+        Mesh_AddPendingTexture(mesh, 1, scene->model->directory, material->texture, strlen(material->texture));
+    } else if (material) {
+        glm_vec3_copy((float*)material->diffuse, mesh->diffuseColor);
+    } else {
+        glm_vec3_fill(mesh->diffuseColor, OBJ_DEFAULT_DIFFUSE);
+    }
+    LoadProfile_Add(profile, LOAD_PHASE_MATERIAL, start_step);
+
+    Mesh_ComputeBounds(mesh);
+    atomic_store(&scene->model->meshDone[index], 1);
+}
+
+static void objSceneFree(ObjScene* scene) {
+    for (uint32_t c = 0; c < scene->numChunks; c++) {
+        free(scene->chunks[c].corners);
+        free(scene->chunks[c].faceStart);
+        free(scene->chunks[c].events);
+    }
+    for (uint32_t i = 0; i < scene->numMaterials; i++) {
+        free(scene->materials[i].name);
+        free(scene->materials[i].texture);
+    }
+    free(scene->chunks);
+    free(scene->positions);
+    free(scene->texCoords);
+    free(scene->normals);
+    free(scene->spans);
+    free(scene->meshes);
+    free(scene->materials);
+    free(scene->meshOrder);
+}
+
+int ObjLoader_Accepts(const char* path) {
+    size_t len = strlen(path);
+    return len > 4 && path[len - 4] == '.' && (path[len - 3] | 0x20) == 'o'
+        && (path[len - 2] | 0x20) == 'b' && (path[len - 1] | 0x20) == 'j';
+}
+
+// Caminhos (já com o diretório do modelo) dos .mtl citados por mtllib, em sequência
+// separados por '\0'; NULL se não houver. Usado pelo cache de malhas, que depende deles.
+char* ObjLoader_MaterialLibraries(const Model* model, uint32_t* count) {
+    *count = 0;
+    MappedFile mf;
+    if (!ObjLoader_Accepts(model->path) || !MappedFile_Open(&mf, model->path)) return NULL;
+
+    char* paths = NULL;
+    size_t used = 0;
+    const char* p = (const char*)mf.data;
+    const char* fileEnd = p + mf.size;
+    while (p < fileEnd) {
+        const char* lineEnd = objFindNewline(p, fileEnd);
+        const char* q = objSkipSpaces(p, lineEnd);
+        if (objKeyword(q, lineEnd, "mtllib", 6)) {
+            uint32_t length;
+            const char* name = objRestOfLine(q + 6, lineEnd, &length);
+            size_t bytes = strlen(model->directory) + 1 + length + 1;
+            paths = (char*)realloc(paths, used + bytes);
+            snprintf(paths + used, bytes, "%s/%.*s", model->directory, (int)length, name);
+            used += bytes;
+            (*count)++;
+        }
+        p = lineEnd + 1;
+    }
+    MappedFile_Close(&mf);
+    return paths;
+}
+
+// Carrega model->path com o leitor nativo, publicando as malhas em ordem de prioridade.
+// Retorna 0 sem ter publicado nada se o arquivo não puder ser lido (o chamador usa o assimp).
+int ObjLoader_Load(Model* model) {
+    uint64_t phaseStart = Clock_NowNs();
+    MappedFile mf;
+    if (!MappedFile_Open(&mf, model->path)) return 0;
+
+    ObjScene scene;
+    memset(&scene, 0, sizeof(scene));
+    scene.model = model;
+
+    // Pedaços de pelo menos OBJ_MIN_CHUNK_BYTES, alguns por thread para equilibrar
+    const char* data = (const char*)mf.data;
+    const char* dataEnd = data + mf.size;
+    size_t wanted = (size_t)(jobThreadCount + 1) * 4;
+    size_t maxChunks = mf.size / OBJ_MIN_CHUNK_BYTES + 1;
+    scene.numChunks = (uint32_t)(wanted < maxChunks ? wanted : maxChunks);
+    scene.chunks = (ObjChunk*)calloc(scene.numChunks, sizeof(ObjChunk));
+    const char* cursor = data;
+    for (uint32_t c = 0; c < scene.numChunks; c++) {
+        const char* end = c + 1 == scene.numChunks ? dataEnd : data + mf.size / scene.numChunks * (c + 1);
+        if (end < cursor) end = cursor;
+        if (end < dataEnd) {
+            end = objFindNewline(end, dataEnd);
+            if (end < dataEnd) end++;
+        }
+        scene.chunks[c].begin = cursor;
+        scene.chunks[c].end = end;
+        cursor = end;
+    }
+
+    JobPool_ParallelFor(scene.numChunks, objCountChunk, &scene);
+    for (uint32_t c = 0; c < scene.numChunks; c++) {
+        ObjChunk* chunk = &scene.chunks[c];
+        chunk->basePosition = scene.numPositions;
+        chunk->baseTexCoord = scene.numTexCoords;
+        chunk->baseNormal = scene.numNormals;
+        scene.numPositions += chunk->numPositions;
+        scene.numTexCoords += chunk->numTexCoords;
+        scene.numNormals += chunk->numNormals;
+    }
+    scene.positions = (float*)malloc(((size_t)scene.numPositions * 3 + 1) * sizeof(float));
+    scene.texCoords = (float*)malloc(((size_t)scene.numTexCoords * 2 + 1) * sizeof(float));
+    scene.normals = (float*)malloc(((size_t)scene.numNormals * 3 + 1) * sizeof(float));
+
+    JobPool_ParallelFor(scene.numChunks, objParseChunk, &scene);
+    int failed = 0;
+    for (uint32_t c = 0; c < scene.numChunks; c++) failed |= scene.chunks[c].failed;
+    if (!failed) objBuildMeshes(&scene);
+    LoadProfile_Add(model->profile, LOAD_PHASE_OBJ_PARSE, phaseStart);
+    if (failed || scene.numMeshes == 0) {
+        objSceneFree(&scene);
+        MappedFile_Close(&mf);
+        return 0;
+    }
+
+    // Ordem de carga: malhas na frente da câmera primeiro
+    JobPool_ParallelFor(scene.numMeshes, objBoundsJob, &scene);
+    MeshLoadOrder* order = (MeshLoadOrder*)malloc(scene.numMeshes * sizeof(MeshLoadOrder));
+    for (uint32_t i = 0; i < scene.numMeshes; i++) {
+        order[i].source = i;
+        order[i].priority = meshViewPriority(model, scene.meshes[i].boxMin, scene.meshes[i].boxMax);
+    }
+    qsort(order, scene.numMeshes, sizeof(MeshLoadOrder), compareMeshLoadOrder);
+    scene.meshOrder = (uint32_t*)malloc(scene.numMeshes * sizeof(uint32_t));
+    for (uint32_t i = 0; i < scene.numMeshes; i++) scene.meshOrder[i] = order[i].source;
+    free(order);
+
+    MeshArenaSizes* sizes = (MeshArenaSizes*)calloc(scene.numMeshes, sizeof(MeshArenaSizes));
+    for (uint32_t i = 0; i < scene.numMeshes; i++) {
+        const ObjMeshDesc* desc = &scene.meshes[scene.meshOrder[i]];
+        const ObjMaterial* material = desc->material >= 0 ? &scene.materials[desc->material] : NULL;
+        sizes[i].numVertices = desc->numCorners;
+        sizes[i].numIndices = 3 * (desc->numCorners - 2 * desc->numFaces);
+        sizes[i].indexType = Mesh_IndexTypeFor(desc->numCorners);
+        if (material && material->texture) {
+            sizes[i].numTextures = 1;
+            sizes[i].pathBytes = pendingTextureBytes(model->directory, strlen(material->texture));
+        }
+    }
+    modelPublishMeshSlots(model, sizes, scene.numMeshes);
+    free(sizes);
+    JobPool_ParallelFor(scene.numMeshes, objFillMeshJob, &scene);
+
+    objSceneFree(&scene);
+    MappedFile_Close(&mf);
+    return 1;
+}
+
+// ---- Agrupamento de malhas por material ----
+// Opcional (--merge-meshes): junta todas as malhas com a mesma textura (ou a mesma
+// cor difusa, se não tiver textura) em uma só, com os índices rebaseados. Model_Draw
+// passa a fazer um desenho por material em vez de um por objeto.
+
+int mergeMeshesByMaterial = 0;
+
+static int meshSameMaterial(const Mesh* a, const Mesh* b) {
+    if (a->numTextures > 0 || b->numTextures > 0) {
+        return a->numTextures > 0 && b->numTextures > 0 && a->textures[0].id == b->textures[0].id;
+    }
+    return memcmp(a->diffuseColor, b->diffuseColor, sizeof(a->diffuseColor)) == 0;
+}
+
+void Model_MergeByMaterial(Model* model) {
+    if (model->numMeshes < 2) return;
+
+    // group[i] = índice do lote da malha i; lotes numerados na ordem de primeira aparição
+    unsigned int* group = (unsigned int*)malloc(model->numMeshes * sizeof(unsigned int));
+    unsigned int* firstOfGroup = (unsigned int*)malloc(model->numMeshes * sizeof(unsigned int));
+    unsigned int numGroups = 0;
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        unsigned int g = 0;
+        while (g < numGroups && !meshSameMaterial(&model->meshes[firstOfGroup[g]], &model->meshes[i])) g++;
+        if (g == numGroups) firstOfGroup[numGroups++] = i;
+        group[i] = g;
+    }
+
+    if (numGroups == model->numMeshes) {
+        free(group); free(firstOfGroup);
+        return;
+    }
+
+    // Os lotes vão para um arena novo; o antigo sai inteiro no fim
+    MeshArenaSizes* sizes = (MeshArenaSizes*)calloc(numGroups, sizeof(MeshArenaSizes));
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        sizes[group[i]].numVertices += model->meshes[i].numVertices;
+        sizes[group[i]].numIndices += model->meshes[i].numIndices;
+    }
+    for (unsigned int g = 0; g < numGroups; g++) {
+        sizes[g].indexType = Mesh_IndexTypeFor(sizes[g].numVertices); // o lote pode passar de 65536 vértices
+        sizes[g].numTextures = model->meshes[firstOfGroup[g]].numTextures;
+    }
+    Mesh* merged;
+    size_t arenaBytes;
+    unsigned char* arena = ModelArena_Create(sizes, numGroups, &merged, NULL, &arenaBytes);
+    free(sizes);
+    for (unsigned int g = 0; g < numGroups; g++) {
+        const Mesh* first = &model->meshes[firstOfGroup[g]];
+        Mesh* batch = &merged[g];
+        glm_vec3_copy((float*)first->diffuseColor, batch->diffuseColor);
+        if (first->numTextures > 0) memcpy(batch->textures, first->textures, first->numTextures * sizeof(Texture));
+        batch->numTextures = first->numTextures;
+        batch->numVertices = 0; // reaproveitados como cursores na cópia
+        batch->numIndices = 0;
+    }
+
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        Mesh* src = &model->meshes[i];
+        Mesh* batch = &merged[group[i]];
+        memcpy(batch->vertices + batch->numVertices, src->vertices, src->numVertices * sizeof(Vertex));
+        for (unsigned int j = 0; j < src->numIndices; j++) {
+            Mesh_SetIndex(batch, batch->numIndices + j, Mesh_GetIndex(src, j) + batch->numVertices);
+        }
+        batch->numVertices += src->numVertices;
+        batch->numIndices += src->numIndices;
+
+        // A referência da primeira malha do lote passou para o lote; as demais são soltas
+        if (i != firstOfGroup[group[i]]) {
+            for (unsigned int t = 0; t < src->numTextures; t++) TextureRegistry_Release(src->textures[t].path);
+        }
+    }
+
+    for (unsigned int g = 0; g < numGroups; g++) Mesh_ComputeBounds(&merged[g]);
+
+    printf("  Malhas agrupadas por material: %u -> %u\n", model->numMeshes, numGroups);
+    free(model->arena);
+    model->arena = arena;
+    model->arenaBytes = arenaBytes;
+    model->meshes = merged;
+    model->numMeshes = numGroups;
+    free(group);
+    free(firstOfGroup);
+}
+
+// ---- Formato compacto de vértices ----
+// Opcional (--quantize): normais em snorm8 e UVs em 16 bits de ponto fixo. A escala
+// das UVs é por malha (potência de 2) para suportar coordenadas fora de [0,1] (GL_REPEAT).
+
+int quantizeVertices = 0;
+
+static GLbyte packSnorm8(float v) {
+    float c = glm_clamp(v, -1.0f, 1.0f) * 127.0f;
+    return (GLbyte)(c < 0.0f ? c - 0.5f : c + 0.5f);
+}
+
+void Mesh_Quantize(const Mesh* src, Mesh* dst) {
+    float maxUV = 0.0f;
+    for (unsigned int i = 0; i < src->numVertices; i++) {
+        maxUV = glm_max(maxUV, fabsf(src->vertices[i].texCoords[0]));
+        maxUV = glm_max(maxUV, fabsf(src->vertices[i].texCoords[1]));
+    }
+    float scale = 16384.0f;
+    while (scale > 1.0f && maxUV * scale > 32767.0f) scale *= 0.5f;
+    dst->texCoordScale = scale;
+
+    for (unsigned int i = 0; i < src->numVertices; i++) {
+        const Vertex* v = &src->vertices[i];
+        PackedVertex* p = &dst->packedVertices[i];
+        glm_vec3_copy((float*)v->position, p->position);
+        p->normal[0] = packSnorm8(v->normal[0]);
+        p->normal[1] = packSnorm8(v->normal[1]);
+        p->normal[2] = packSnorm8(v->normal[2]);
+        p->normal[3] = 0;
+        p->texCoords[0] = (GLshort)lrintf(glm_clamp(v->texCoords[0] * scale, -32767.0f, 32767.0f));
+        p->texCoords[1] = (GLshort)lrintf(glm_clamp(v->texCoords[1] * scale, -32767.0f, 32767.0f));
+    }
+}
+
+// Refaz o arena do modelo com os vértices compactos (índices e texturas copiados)
+void Model_Quantize(Model* model) {
+    MeshArenaSizes* sizes = (MeshArenaSizes*)calloc(model->numMeshes ? model->numMeshes : 1, sizeof(MeshArenaSizes));
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        sizes[i].numVertices = model->meshes[i].numVertices;
+        sizes[i].numIndices = model->meshes[i].numIndices;
+        sizes[i].indexType = model->meshes[i].indexType;
+        sizes[i].numTextures = model->meshes[i].numTextures;
+        sizes[i].packed = 1;
+    }
+    Mesh* packed;
+    size_t arenaBytes;
+    unsigned char* arena = ModelArena_Create(sizes, model->numMeshes, &packed, NULL, &arenaBytes);
+    free(sizes);
+
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        const Mesh* src = &model->meshes[i];
+        Mesh* dst = &packed[i];
+        memcpy(dst->indices, src->indices, (size_t)src->numIndices * Mesh_IndexSize(src->indexType));
+        if (src->numTextures > 0) memcpy(dst->textures, src->textures, src->numTextures * sizeof(Texture));
+        dst->numTextures = src->numTextures;
+        glm_vec3_copy((float*)src->diffuseColor, dst->diffuseColor);
+        glm_vec3_copy((float*)src->boundsMin, dst->boundsMin);
+        glm_vec3_copy((float*)src->boundsMax, dst->boundsMax);
+        glm_vec4_copy((float*)src->boundingSphere, dst->boundingSphere);
+        Mesh_Quantize(src, dst);
+    }
+    free(model->arena);
+    model->arena = arena;
+    model->arenaBytes = arenaBytes;
+    model->meshes = packed;
+}
+
+// Bytes de geometria do modelo: atual e como seria no layout antigo (Vertex + uint32)
+static void modelGeometryBytes(const Model* model, size_t* current, size_t* legacy) {
+    *current = 0; *legacy = 0;
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        const Mesh* mesh = &model->meshes[i];
+        *legacy += (size_t)mesh->numVertices * sizeof(Vertex) + (size_t)mesh->numIndices * sizeof(GLuint);
+        *current += (size_t)mesh->numVertices * (mesh->packedVertices ? sizeof(PackedVertex) : sizeof(Vertex))
+                  + (size_t)mesh->numIndices * Mesh_IndexSize(mesh->indexType);
+    }
+}
+
+// Passos comuns depois que as malhas estão prontas (vindo do cache ou do assimp)
+void Model_FinishLoad(Model* model) {
+    if (mergeMeshesByMaterial) {
+        uint64_t phaseStart = Clock_NowNs();
+        Model_MergeByMaterial(model);
+        LoadProfile_Add(model->profile, LOAD_PHASE_MERGE, phaseStart);
+    }
+    if (quantizeVertices) {
+        uint64_t phaseStart = Clock_NowNs();
+        Model_Quantize(model);
+        LoadProfile_Add(model->profile, LOAD_PHASE_QUANTIZE, phaseStart);
+    }
+
+    size_t current, legacy;
+    modelGeometryBytes(model, &current, &legacy);
+    printf("  Geometria: %.1f KB (layout antigo: %.1f KB, economia de %.1f KB / %.0f%%)\n",
+           current / 1024.0, legacy / 1024.0, (legacy - current) / 1024.0,
+           legacy ? 100.0 * (legacy - current) / legacy : 0.0);
+    printf("  Arena: %.1f KB em um bloco para %u malhas\n", model->arenaBytes / 1024.0, model->numMeshes);
+}
+
+// Importa model->path pelo assimp, publicando as malhas em ordem de prioridade
+static int modelImportAssimp(Model* model) {
+    uint64_t phaseStart = Clock_NowNs();
+    const struct aiScene* scene = aiImportFile(model->path, aiProcess_Triangulate | aiProcess_FlipUVs);
+    LoadProfile_Add(model->profile, LOAD_PHASE_IMPORT, phaseStart);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        fprintf(stderr, "ERRO::ASSIMP:: %s\n", aiGetErrorString());
+        return 0;
+    }
+
+    // --- NOVA LÓGICA DE ALOCAÇÃO EM PASSOS ---
+    // 1. Contar tudo primeiro
+    unsigned int totalMeshes = 0;
+    unsigned int totalTextures = 0; // referências de textura (o registro cuida da deduplicação)
+    phaseStart = Clock_NowNs();
+    processNode_pass1_count(scene->mRootNode, scene, &totalMeshes, &totalTextures);
+    LoadProfile_Add(model->profile, LOAD_PHASE_COUNT, phaseStart);
+
+    // 2. Ordem de carga: malhas na frente da câmera primeiro
+    unsigned int mesh_index_counter = 0;
+    struct aiMesh** sceneOrder = (struct aiMesh**)malloc((totalMeshes ? totalMeshes : 1) * sizeof(struct aiMesh*));
+    struct aiMesh** meshOrder = (struct aiMesh**)malloc((totalMeshes ? totalMeshes : 1) * sizeof(struct aiMesh*));
+    MeshLoadOrder* order = (MeshLoadOrder*)malloc((totalMeshes ? totalMeshes : 1) * sizeof(MeshLoadOrder));
+    processNode_pass2_fillData(scene->mRootNode, scene, sceneOrder, &mesh_index_counter);
+    for (unsigned int i = 0; i < totalMeshes; i++) {
+        const struct aiMesh* mesh = sceneOrder[i];
+        vec3 boxMin = { 0.0f, 0.0f, 0.0f }, boxMax = { 0.0f, 0.0f, 0.0f };
+        for (unsigned int v = 0; v < mesh->mNumVertices; v++) {
+            vec3 p = { mesh->mVertices[v].x, mesh->mVertices[v].y, mesh->mVertices[v].z };
+            if (v == 0) { glm_vec3_copy(p, boxMin); glm_vec3_copy(p, boxMax); }
+            glm_vec3_minv(boxMin, p, boxMin);
+            glm_vec3_maxv(boxMax, p, boxMax);
+        }
+        order[i].source = i;
+        order[i].priority = meshViewPriority(model, boxMin, boxMax);
+    }
+    qsort(order, totalMeshes, sizeof(MeshLoadOrder), compareMeshLoadOrder);
+    for (unsigned int i = 0; i < totalMeshes; i++) meshOrder[i] = sceneOrder[order[i].source];
+    free(sceneOrder);
+    free(order);
+
+    // 3. Alocar o arena de uma só vez e preencher em paralelo, uma tarefa por aiMesh
+    MeshArenaSizes* sizes = (MeshArenaSizes*)malloc((totalMeshes ? totalMeshes : 1) * sizeof(MeshArenaSizes));
+    for (unsigned int i = 0; i < totalMeshes; i++) aiMeshArenaSizes(meshOrder[i], scene, model->directory, &sizes[i]);
+    modelPublishMeshSlots(model, sizes, totalMeshes);
+    free(sizes);
+    MeshFillJob fillJob = { scene, meshOrder, model };
+    JobPool_ParallelFor(totalMeshes, processMeshJob, &fillJob);
+    free(meshOrder);
+
+    aiReleaseImport(scene);
+    return 1;
+}
+
+// Grava o .meshcache aqui mesmo, fora da thread do GL (o arquivo pode ter centenas de MB)
+static void modelSaveCache(Model* model) {
+    uint64_t phaseStart = Clock_NowNs();
+    MeshCache_Save(model, model->path);
+    LoadProfile_Add(model->profile, LOAD_PHASE_CACHE_WRITE, phaseStart);
+}
+
+// Thread de carga: cache, leitor nativo de OBJ ou assimp, nessa ordem
+static void* modelLoadThread(void* arg) {
+    Model* model = (Model*)arg;
+
+    // Partida quente: monta o modelo direto do cache, sem passar pelo assimp
+    uint64_t phaseStart = Clock_NowNs();
+    if (MeshCache_Load(model, model->path)) {
+        LoadProfile_Add(model->profile, LOAD_PHASE_CACHE_READ, phaseStart);
+        model->loadedFromCache = 1;
+        atomic_store(&model->cpuState, MODEL_READY);
+        return NULL;
+    }
+
+    if (nativeObjLoader && ObjLoader_Accepts(model->path)) {
+        if (ObjLoader_Load(model)) {
+            modelSaveCache(model);
+            atomic_store(&model->cpuState, MODEL_READY);
+            return NULL;
+        }
+        fprintf(stderr, "Aviso: leitor nativo não entendeu %s, usando o assimp\n", model->path);
+    }
+
+    if (!modelImportAssimp(model)) {
+        atomic_store(&model->cpuState, MODEL_FAILED);
+        return NULL;
+    }
+    modelSaveCache(model);
+    atomic_store(&model->cpuState, MODEL_READY);
+    return NULL;
+}
+
+// Diretório do arquivo (para resolver .mtl e texturas); "." se não houver
+static char* modelDirectoryOf(const char* path) {
+    char* directory;
+    const char* last_slash = strrchr(path, '/'); const char* last_backslash = strrchr(path, '\\');
+    const char* final_separator = (last_slash > last_backslash) ? last_slash : last_backslash;
+    if (final_separator) { size_t dir_len = final_separator - path; directory = (char*)malloc(dir_len + 1); strncpy(directory, path, dir_len); directory[dir_len] = '\0'; }
+    else { directory = (char*)malloc(2); strcpy(directory, "."); }
+    return directory;
+}
+
+// Começa a carregar o modelo em segundo plano. O modelo volta vazio e vai ganhando
+// malhas a cada Model_PumpStreaming.
+Model* Model_CreateAsync(const char* path) {
+    printf("\n--- INICIANDO CARREGAMENTO DE: %s ---\n", path);
+    Model* model = (Model*)calloc(1, sizeof(Model));
+    if (!model) return NULL;
+    model->loadStartNs = Clock_NowNs();
+    model->profile = LoadProfile_Create(path);
+    model->path = (char*)malloc(strlen(path) + 1);
+    strcpy(model->path, path);
+    model->state = MODEL_LOADING;
+    atomic_init(&model->cpuState, MODEL_LOADING);
+    atomic_init(&model->meshesTotal, 0);
+
+    model->directory = modelDirectoryOf(path);
+
+    // A prioridade usa a câmera inicial (cameraPos muda na thread do GL durante a carga)
+    glm_vec3_copy(cameraPos, model->loadViewPos);
+    model->loadViewDir[0] = cos(glm_rad(cameraYaw)) * cos(glm_rad(cameraPitch));
+    model->loadViewDir[1] = sin(glm_rad(cameraPitch));
+    model->loadViewDir[2] = sin(glm_rad(cameraYaw)) * cos(glm_rad(cameraPitch));
+    glm_vec3_normalize(model->loadViewDir);
+
+    if (pthread_create(&model->loadThread, NULL, modelLoadThread, model) == 0) {
+        model->loadThreadRunning = 1;
+    } else {
+        modelLoadThread(model); // sem thread: carrega aqui mesmo
+    }
+    return model;
+}
+
+// Chamado a cada quadro na thread do GL: finaliza (texturas) as malhas que a thread de
+// carga já publicou, na ordem de prioridade, e fecha o carregamento quando ela termina.
+ModelLoadState Model_PumpStreaming(Model* model) {
+    if (!model) return MODEL_FAILED;
+    if (model->state != MODEL_LOADING) return model->state;
+
+    // Lido antes das flags: se a CPU já terminou, todas as malhas estão marcadas
+    int cpuState = atomic_load(&model->cpuState);
+    unsigned int total = atomic_load(&model->meshesTotal);
+    unsigned int first = model->numMeshes;
+    uint64_t phaseStart = Clock_NowNs();
+    while (model->numMeshes < total && atomic_load(&model->meshDone[model->numMeshes])) {
+        Model_ResolveMeshTextures(model, &model->meshes[model->numMeshes]);
+        model->numMeshes++;
+    }
+    if (model->numMeshes > first) {
+        LoadProfile_Add(model->profile, LOAD_PHASE_MATERIAL, phaseStart);
+        phaseStart = Clock_NowNs();
+        for (unsigned int i = first; i < model->numMeshes; i++) Mesh_PrepareForDraw(&model->meshes[i]);
+        LoadProfile_Add(model->profile, LOAD_PHASE_BUFFER_UPLOAD, phaseStart);
+        if (first == 0) printf("  %s: primeira malha pronta em %.2f ms\n", model->path, (Clock_NowNs() - model->loadStartNs) / 1e6);
+    }
+    if (cpuState == MODEL_LOADING) return MODEL_LOADING;
+
+    if (model->loadThreadRunning) {
+        pthread_join(model->loadThread, NULL);
+        model->loadThreadRunning = 0;
+    }
+    model->meshDone = NULL; // mora no arena
+    if (cpuState == MODEL_FAILED) {
+        model->state = MODEL_FAILED;
+        return MODEL_FAILED;
+    }
+
+    // Junção/compactação refazem o arena: buffers e listas das malhas antigas não servem mais
+    if (mergeMeshesByMaterial || quantizeVertices) {
+        for (unsigned int i = 0; i < model->numMeshes; i++) Mesh_ReleaseGpu(&model->meshes[i]);
+    }
+    Model_FinishLoad(model);
+    phaseStart = Clock_NowNs();
+    for (unsigned int i = 0; i < model->numMeshes; i++) Mesh_PrepareForDraw(&model->meshes[i]);
+    LoadProfile_Add(model->profile, LOAD_PHASE_BUFFER_UPLOAD, phaseStart);
+    model->profile->wallNs = Clock_NowNs() - model->loadStartNs;
+    if (model->loadedFromCache) printf("--- %s CARREGADO DO CACHE em %.2f ms (%u malhas) ---\n", model->path, model->profile->wallNs / 1e6, model->numMeshes);
+    else printf("--- CARREGAMENTO DE %s CONCLUÍDO em %.2f ms (assimp, sem cache) ---\n", model->path, model->profile->wallNs / 1e6);
+    LoadProfile_Print(model->profile);
+    model->state = MODEL_READY;
+    return MODEL_READY;
+}
+
+// Carregamento bloqueante: espera a thread de carga e finaliza tudo de uma vez
+Model* Model_Create(const char* path) {
+    Model* model = Model_CreateAsync(path);
+    if (!model) return NULL;
+    if (model->loadThreadRunning) {
+        pthread_join(model->loadThread, NULL);
+        model->loadThreadRunning = 0;
+    }
+    if (Model_PumpStreaming(model) != MODEL_READY) {
+        Model_Destroy(model);
+        return NULL;
+    }
+    return model;
+}
+
+// --bench-obj: mede o leitor nativo contra o assimp nos modelos do jogo e confere se a
+// saída é a mesma. Só CPU (sem GL, sem cache); as malhas ficam na ordem do arquivo.
+static Model* objBenchLoad(const char* path, int native, int runs, double* bestMs) {
+    Model* model = NULL;
+    *bestMs = 0.0;
+    for (int run = 0; run < runs; run++) {
+        Model_Destroy(model);
+        model = (Model*)calloc(1, sizeof(Model));
+        model->path = (char*)malloc(strlen(path) + 1);
+        strcpy(model->path, path);
+        model->directory = modelDirectoryOf(path);
+        atomic_init(&model->meshesTotal, 0);
+
+        uint64_t start = Clock_NowNs();
+        int ok = native ? ObjLoader_Load(model) : modelImportAssimp(model);
+        double ms = (Clock_NowNs() - start) / 1e6;
+        if (!ok) { Model_Destroy(model); return NULL; }
+        if (run == 0 || ms < *bestMs) *bestMs = ms;
+    }
+    return model;
+}
+
+static int objBenchSameMesh(const Mesh* a, const Mesh* b, float* maxDiff) {
+    if (a->numVertices != b->numVertices || a->numIndices != b->numIndices || a->numTextures != b->numTextures) return 0;
+    for (unsigned int t = 0; t < a->numTextures; t++) {
+        if (strcmp(a->textures[t].path, b->textures[t].path) != 0) return 0;
+    }
+    int same = glm_vec3_distance((float*)a->diffuseColor, (float*)b->diffuseColor) < 1e-5f;
+    for (unsigned int v = 0; v < a->numVertices; v++) {
+        const float* fa = (const float*)&a->vertices[v];
+        const float* fb = (const float*)&b->vertices[v];
+        for (unsigned int k = 0; k < sizeof(Vertex) / sizeof(float); k++) {
+            float d = fabsf(fa[k] - fb[k]);
+            if (d > *maxDiff) *maxDiff = d;
+        }
+    }
+    for (unsigned int i = 0; i < a->numIndices && same; i++) same = Mesh_GetIndex(a, i) == Mesh_GetIndex(b, i);
+    return same;
+}
+
+int ObjLoader_Benchmark(void) {
+    static const char* files[] = { "CLASSROOM.obj", "MEN.obj", "Power_Hammer.obj", "pop base.obj" };
+    const int runs = 5;
+    printf("\nBenchmark OBJ: leitor nativo x assimp (melhor de %d execuções)\n", runs);
+    printf("  %-18s %10s %10s %7s %7s %9s %10s %10s\n", "arquivo", "nativo ms", "assimp ms", "ganho", "malhas", "vértices", "idênticas", "dif. máx");
+    for (size_t f = 0; f < sizeof(files) / sizeof(files[0]); f++) {
+        double nativeMs, assimpMs;
+        Model* native = objBenchLoad(files[f], 1, runs, &nativeMs);
+        Model* reference = objBenchLoad(files[f], 0, runs, &assimpMs);
+        if (!native || !reference) {
+            printf("  %-18s %s\n", files[f], !native ? "falhou no leitor nativo" : "falhou no assimp");
+            Model_Destroy(native);
+            Model_Destroy(reference);
+            continue;
+        }
+
+        unsigned int numMeshes = atomic_load(&native->meshesTotal);
+        unsigned int refMeshes = atomic_load(&reference->meshesTotal);
+        unsigned int same = 0, vertices = 0;
+        float maxDiff = 0.0f;
+        for (unsigned int i = 0; i < numMeshes; i++) {
+            vertices += native->meshes[i].numVertices;
+            if (i < refMeshes) same += objBenchSameMesh(&native->meshes[i], &reference->meshes[i], &maxDiff);
+        }
+        char meshes[32], identical[32];
+        snprintf(meshes, sizeof(meshes), numMeshes == refMeshes ? "%u" : "%u/%u", numMeshes, refMeshes);
+        snprintf(identical, sizeof(identical), "%u/%u", same, refMeshes);
+        printf("  %-18s %10.2f %10.2f %6.1fx %7s %9u %10s %10.2g\n", files[f], nativeMs, assimpMs,
+               nativeMs > 0.0 ? assimpMs / nativeMs : 0.0, meshes, vertices, identical, maxDiff);
+        Model_Destroy(native);
+        Model_Destroy(reference);
+    }
+    return 0;
+}
+
+// Caixa alinhada aos eixos e esfera envolvente da malha, em qualquer um dos layouts. A
+// esfera usa o centro da caixa e a maior distância até ele (mais justa que meia diagonal).
+void Mesh_ComputeBounds(Mesh* mesh) {
+    glm_vec3_zero(mesh->boundsMin);
+    glm_vec3_zero(mesh->boundsMax);
+    glm_vec4_zero(mesh->boundingSphere);
+    if (mesh->numVertices == 0) return;
+
+    size_t stride = mesh->packedVertices ? sizeof(PackedVertex) : sizeof(Vertex);
+    const unsigned char* base = mesh->packedVertices ? (const unsigned char*)mesh->packedVertices : (const unsigned char*)mesh->vertices;
+    glm_vec3_copy((float*)base, mesh->boundsMin); // posição é o primeiro campo nos dois layouts
+    glm_vec3_copy((float*)base, mesh->boundsMax);
+    for (unsigned int i = 1; i < mesh->numVertices; i++) {
+        float* p = (float*)(base + i * stride);
+        glm_vec3_minv(mesh->boundsMin, p, mesh->boundsMin);
+        glm_vec3_maxv(mesh->boundsMax, p, mesh->boundsMax);
+    }
+
+    vec3 center;
+    glm_vec3_center(mesh->boundsMin, mesh->boundsMax, center);
+    float radius2 = 0.0f;
+    for (unsigned int i = 0; i < mesh->numVertices; i++) {
+        float* p = (float*)(base + i * stride);
+        radius2 = glm_max(radius2, glm_vec3_distance2(center, p));
+    }
+    glm_vec3_copy(center, mesh->boundingSphere);
+    mesh->boundingSphere[3] = sqrtf(radius2);
+}
+
+// Conversão de um aiMesh (só CPU, roda nas threads do pool) para as fatias de arena já
+// apontadas em outMesh. Texturas ficam pendentes até Model_ResolveMeshTextures.
+void processMesh(struct aiMesh* mesh, const struct aiScene* scene, const char* directory, Mesh* outMesh, LoadProfile* profile) {
+    Mesh* newMesh = outMesh;
+    
+    uint64_t start_step = Clock_NowNs();
+    // Carrega Vértices
+    for (unsigned int i = 0; i < newMesh->numVertices; i++) {
+        newMesh->vertices[i].position[0] = mesh->mVertices[i].x; newMesh->vertices[i].position[1] = mesh->mVertices[i].y; newMesh->vertices[i].position[2] = mesh->mVertices[i].z;
+        if (mesh->mNormals) { newMesh->vertices[i].normal[0] = mesh->mNormals[i].x; newMesh->vertices[i].normal[1] = mesh->mNormals[i].y; newMesh->vertices[i].normal[2] = mesh->mNormals[i].z; }
+        else { glm_vec3_zero(newMesh->vertices[i].normal); }
+        if (mesh->mTextureCoords[0]) { newMesh->vertices[i].texCoords[0] = mesh->mTextureCoords[0][i].x; newMesh->vertices[i].texCoords[1] = mesh->mTextureCoords[0][i].y; }
+        else { glm_vec2_zero(newMesh->vertices[i].texCoords); }
+    }
+    LoadProfile_Add(profile, LOAD_PHASE_VERTEX_COPY, start_step);
+
+    start_step = Clock_NowNs();
+    // Carrega Índices (numIndices e o tipo já vieram de aiMeshArenaSizes)
+    unsigned int index_counter = 0;
+    if (newMesh->indexType == GL_UNSIGNED_SHORT) {
+        GLushort* out = (GLushort*)newMesh->indices;
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++) { struct aiFace face = mesh->mFaces[i]; for (unsigned int j = 0; j < face.mNumIndices; j++) { out[index_counter++] = (GLushort)face.mIndices[j]; } }
+    } else {
+        GLuint* out = (GLuint*)newMesh->indices;
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++) { struct aiFace face = mesh->mFaces[i]; for (unsigned int j = 0; j < face.mNumIndices; j++) { out[index_counter++] = face.mIndices[j]; } }
+    }
+    LoadProfile_Add(profile, LOAD_PHASE_INDEX_FLATTEN, start_step);
+    
+    start_step = Clock_NowNs();
+    // Processa materiais
+    if (mesh->mMaterialIndex >= 0) {
+        struct aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+        collectMaterialTextures(material, aiTextureType_DIFFUSE, directory, newMesh);
+        if (newMesh->numTextures == 0) {
+            struct aiColor4D color;
+            if (aiGetMaterialColor(material, AI_MATKEY_COLOR_DIFFUSE, &color) == AI_SUCCESS) { newMesh->diffuseColor[0] = color.r; newMesh->diffuseColor[1] = color.g; newMesh->diffuseColor[2] = color.b; }
+            else { glm_vec3_one(newMesh->diffuseColor); }
+        }
+    }
+    LoadProfile_Add(profile, LOAD_PHASE_MATERIAL, start_step);
+
+    Mesh_ComputeBounds(newMesh);
+}
+
+// ---- Backends de desenho ----
+// Imediato (glBegin/glEnd a cada quadro), display list (o mesmo fluxo gravado uma vez e
+// repetido com glCallList) ou VBO (buffers enviados uma vez, um glDrawElements por
+// malha). Os três desenham exatamente a mesma coisa, para comparar na mesma cena.
+
+RenderBackend renderBackend = RENDER_VBO;
+
+static const char* renderBackendNames[RENDER_BACKEND_COUNT] = { "immediate", "list", "vbo" };
+
+const char* RenderBackend_Name(RenderBackend backend) {
+    return renderBackendNames[backend];
+}
+
+int RenderBackend_Parse(const char* name, RenderBackend* out) {
+    for (int i = 0; i < RENDER_BACKEND_COUNT; i++) {
+        if (strcmp(name, renderBackendNames[i]) == 0) { *out = (RenderBackend)i; return 1; }
+    }
+    return 0;
+}
+
+// Buffer objects são core desde o GL 1.5; sem eles o modo VBO vira display list
+RenderBackend RenderBackend_Effective(void) {
+    if (renderBackend == RENDER_VBO && !GLAD_GL_VERSION_1_5) return RENDER_DISPLAY_LIST;
+    return renderBackend;
+}
+
+// Copia a geometria da malha para a GPU uma única vez (GL_STATIC_DRAW). A cópia na
+// CPU continua no arena (cache, junção e compactação ainda leem dela).
+int Mesh_UploadBuffers(Mesh* mesh) {
+    if (!GLAD_GL_VERSION_1_5 || mesh->numIndices == 0) return 0;
+    GLsizeiptr vertexBytes = (GLsizeiptr)mesh->numVertices * (mesh->packedVertices ? sizeof(PackedVertex) : sizeof(Vertex));
+    GLsizeiptr indexBytes = (GLsizeiptr)mesh->numIndices * Mesh_IndexSize(mesh->indexType);
+
+    glGenBuffers(1, &mesh->vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, mesh->packedVertices ? (const void*)mesh->packedVertices : (const void*)mesh->vertices, GL_STATIC_DRAW);
+    glGenBuffers(1, &mesh->indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, mesh->indices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    return 1;
+}
+
+void Mesh_ReleaseBuffers(Mesh* mesh) {
+    if (mesh->vertexBuffer) glDeleteBuffers(1, &mesh->vertexBuffer);
+    if (mesh->indexBuffer) glDeleteBuffers(1, &mesh->indexBuffer);
+    mesh->vertexBuffer = 0;
+    mesh->indexBuffer = 0;
+}
+
+static inline int meshSendsTexCoords(const Mesh* mesh) {
+    return mesh->numTextures > 0 || mesh->keepTexCoords;
+}
+
+// Triângulos da malha em modo imediato. Textura e cor ficam fora (meshBindMaterial),
+// então o mesmo fluxo serve para desenhar direto ou para gravar na display list.
+static void meshEmitImmediate(const Mesh* currentMesh) {
+    glBegin(GL_TRIANGLES);
+    if (currentMesh->packedVertices) {
+        float uvScale = 1.0f / currentMesh->texCoordScale;
+        for (unsigned int j = 0; j < currentMesh->numIndices; j++) {
+            const PackedVertex* v = &currentMesh->packedVertices[Mesh_GetIndex(currentMesh, j)];
+            if (meshSendsTexCoords(currentMesh)) {
+                glTexCoord2f(v->texCoords[0] * uvScale, v->texCoords[1] * uvScale);
+            }
+            glNormal3bv(v->normal);
+            glVertex3fv((const GLfloat*)v->position);
+        }
+    } else {
+        for (unsigned int j = 0; j < currentMesh->numIndices; j++) {
+            unsigned int vertexIndex = Mesh_GetIndex(currentMesh, j);
+            
+            if (meshSendsTexCoords(currentMesh)) {
+                glTexCoord2fv((const GLfloat*)currentMesh->vertices[vertexIndex].texCoords);
+            }
+            glNormal3fv((const GLfloat*)currentMesh->vertices[vertexIndex].normal);
+            glVertex3fv((const GLfloat*)currentMesh->vertices[vertexIndex].position);
+        }
+    }
+    glEnd();
+}
+
+int Mesh_CompileDisplayList(Mesh* mesh) {
+    if (mesh->numIndices == 0) return 0;
+    mesh->displayList = glGenLists(1);
+    if (!mesh->displayList) return 0;
+    glNewList(mesh->displayList, GL_COMPILE);
+    meshEmitImmediate(mesh);
+    glEndList();
+    return 1;
+}
+
+void Mesh_ReleaseDisplayList(Mesh* mesh) {
+    if (mesh->displayList) glDeleteLists(mesh->displayList, 1);
+    mesh->displayList = 0;
+}
+
+// Cria o que o backend atual precisa (buffers ou lista) se ainda não existir. Chamado ao
+// finalizar cada malha e de novo em Model_Draw, que cobre a troca de backend em execução.
+void Mesh_PrepareForDraw(Mesh* mesh) {
+    RenderBackend backend = RenderBackend_Effective();
+    if (backend == RENDER_VBO && !mesh->vertexBuffer) Mesh_UploadBuffers(mesh);
+    else if (backend == RENDER_DISPLAY_LIST && !mesh->displayList) Mesh_CompileDisplayList(mesh);
+}
+
+// Só chama o GL para o que existe (o --bench-obj roda sem contexto)
+void Mesh_ReleaseGpu(Mesh* mesh) {
+    Mesh_ReleaseBuffers(mesh);
+    Mesh_ReleaseDisplayList(mesh);
+}
+
+static void meshBindMaterial(const Mesh* mesh) {
+    if (mesh->numTextures > 0) {
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, mesh->textures[0].id);
+    } else {
+        glDisable(GL_TEXTURE_2D);
+        glColor3fv((const GLfloat*)mesh->diffuseColor);
+    }
+}
+
+// Aponta os arrays para o VBO da malha (layout completo ou compacto) e desenha; com
+// instances > 0, essa quantidade de cópias (atributos por instância ficam com quem chama)
+static void meshDrawBuffers(const Mesh* currentMesh, GLsizei instances) {
+    int textured = meshSendsTexCoords(currentMesh);
+    if (textured) glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    glBindBuffer(GL_ARRAY_BUFFER, currentMesh->vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, currentMesh->indexBuffer);
+    if (currentMesh->packedVertices) {
+        GLsizei stride = sizeof(PackedVertex);
+        glVertexPointer(3, GL_FLOAT, stride, (const void*)offsetof(PackedVertex, position));
+        glNormalPointer(GL_BYTE, stride, (const void*)offsetof(PackedVertex, normal));
+        if (textured) {
+            // UV em ponto fixo: a matriz de textura desfaz a escala
+            glTexCoordPointer(2, GL_SHORT, stride, (const void*)offsetof(PackedVertex, texCoords));
+            glMatrixMode(GL_TEXTURE);
+            glPushMatrix();
+            glLoadIdentity();
+            glScalef(1.0f / currentMesh->texCoordScale, 1.0f / currentMesh->texCoordScale, 1.0f);
+        }
+    } else {
+        GLsizei stride = sizeof(Vertex);
+        glVertexPointer(3, GL_FLOAT, stride, (const void*)offsetof(Vertex, position));
+        glNormalPointer(GL_FLOAT, stride, (const void*)offsetof(Vertex, normal));
+        if (textured) glTexCoordPointer(2, GL_FLOAT, stride, (const void*)offsetof(Vertex, texCoords));
+    }
+
+    if (instances > 0) glDrawElementsInstanced(GL_TRIANGLES, currentMesh->numIndices, currentMesh->indexType, (const void*)0, instances);
+    else glDrawElements(GL_TRIANGLES, currentMesh->numIndices, currentMesh->indexType, (const void*)0);
+
+    if (textured) {
+        if (currentMesh->packedVertices) {
+            glPopMatrix();
+            glMatrixMode(GL_MODELVIEW);
+        }
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    }
+}
+
+static void modelBeginArrays(RenderBackend backend) {
+    if (backend == RENDER_VBO) {
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_NORMAL_ARRAY);
+    }
+}
+
+static void modelEndArrays(RenderBackend backend) {
+    if (backend == RENDER_VBO) {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glDisableClientState(GL_NORMAL_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+    }
+}
+
+// Só a geometria, pelo backend dado (material fica com quem chama)
+static void meshDrawGeometry(Mesh* mesh, RenderBackend backend) {
+    Mesh_PrepareForDraw(mesh);
+    if (backend == RENDER_VBO && mesh->vertexBuffer) meshDrawBuffers(mesh, 0);
+    else if (backend == RENDER_DISPLAY_LIST && mesh->displayList) glCallList(mesh->displayList);
+    else meshEmitImmediate(mesh);
+}
+
+// Com visibleMeshes (um bit por malha), descarta as que estão fora do conjunto; com planes
+// (frustum no espaço do modelo), as que ficam inteiramente fora da tela: primeiro pela
+// esfera, depois pela caixa.
+static int modelMeshVisible(const Model* model, unsigned int i, vec4* planes, const unsigned char* visibleMeshes) {
+    const Mesh* currentMesh = &model->meshes[i];
+    if (visibleMeshes && !(visibleMeshes[i >> 3] & (1u << (i & 7)))) {
+        cullStats.meshesHidden++;
+        return 0;
+    }
+    if (planes) {
+        vec3 box[2];
+        glm_vec3_copy((float*)currentMesh->boundsMin, box[0]);
+        glm_vec3_copy((float*)currentMesh->boundsMax, box[1]);
+        cullStats.meshesTested++;
+        if (!glm_sphere_frustum((float*)currentMesh->boundingSphere, planes) || !glm_aabb_frustum(box, planes)) {
+            cullStats.meshesCulled++;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Desenha as malhas do modelo na hora, na ordem do arena
+static void modelDrawMeshes(Model* model, vec4* planes, const unsigned char* visibleMeshes) {
+    RenderBackend backend = RenderBackend_Effective();
+    modelBeginArrays(backend);
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        Mesh* currentMesh = &model->meshes[i];
+        if (!modelMeshVisible(model, i, planes, visibleMeshes)) continue;
+        meshBindMaterial(currentMesh);
+        meshDrawGeometry(currentMesh, backend);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    modelEndArrays(backend);
+}
+
+void Model_Draw(Model* model) {
+    modelDrawMeshes(model, NULL, NULL);
+}
+
+// Enfileira as malhas visíveis na passada opaca (o modelo fica no espaço do mundo)
+void Model_Submit(Model* model, mat4 view, vec4* planes, const unsigned char* visibleMeshes) {
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        Mesh* currentMesh = &model->meshes[i];
+        if (!modelMeshVisible(model, i, planes, visibleMeshes)) continue;
+        GLuint texture = currentMesh->numTextures > 0 ? currentMesh->textures[0].id : 0;
+        RenderQueue_Submit(RENDER_PASS_OPAQUE, currentMesh, view, texture, currentMesh->diffuseColor, GL_TRUE);
+    }
+}
+
+// Caixa que envolve todas as malhas já finalizadas (espaço do modelo)
+void Model_LocalBounds(const Model* model, vec3 boxMin, vec3 boxMax) {
+    glm_vec3_zero(boxMin);
+    glm_vec3_zero(boxMax);
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        const Mesh* mesh = &model->meshes[i];
+        if (i == 0) { glm_vec3_copy((float*)mesh->boundsMin, boxMin); glm_vec3_copy((float*)mesh->boundsMax, boxMax); }
+        glm_vec3_minv(boxMin, (float*)mesh->boundsMin, boxMin);
+        glm_vec3_maxv(boxMax, (float*)mesh->boundsMax, boxMax);
+    }
+}
+
+void Model_Destroy(Model* model) {
+    if (!model) return;
+    if (model->loadThreadRunning) pthread_join(model->loadThread, NULL);
+
+    // Solta as referências no registro (a textura só é apagada sem outros usuários).
+    // Malhas que o streaming não finalizou só têm caminhos pendentes, que moram no arena.
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        for (unsigned int t = 0; t < model->meshes[i].numTextures; t++) {
+            TextureRegistry_Release(model->meshes[i].textures[t].path);
+        }
+        Mesh_ReleaseGpu(&model->meshes[i]);
+    }
+    free(model->arena); // malhas, vértices, índices e texturas
+
+    // Libera o resto
+    if (model->directory) free(model->directory);
+    free(model->path);
+    free(model);
+}
+
+// ---- Conjunto potencialmente visível por direção (PVS) ----
+// A câmera da professora não sai de cameraPos; só yaw/pitch mudam. Então as malhas da
+// sala que podem aparecer dependem só da direção. As direções são divididas em células
+// de PVS_CELL_DEGREES; para cada célula a sala é desenhada uma vez com uma cor por malha
+// (frustum alargado para cobrir qualquer direção dentro da célula) e as cores lidas de
+// volta viram um bit por malha. A montagem é feita aos poucos (algumas células por
+// quadro) e gravada em "<modelo>.pvs"; células ainda não montadas desenham tudo.
+// O conjunto precisa ser conservador: a montagem tem pelo menos a densidade de pixels da
+// janela (altura arredondada para cima em PVS_WINDOW_HEIGHT_STEP) e malhas pequenas
+// demais para cobrir um pixel entram pela esfera envolvente. O frustum é o da proporção
+// mais larga suportada, então redimensionar a janela só refaz o PVS quando ela cresce.
+
+#define PVS_CACHE_MAGIC "AAPVS\0\0"
+#define PVS_CACHE_VERSION 2
+#define PVS_CELL_DEGREES 15.0f
+#define PVS_YAW_CELLS 24
+#define PVS_PITCH_CELLS 12
+#define PVS_MARGIN_DEGREES 2.0f
+#define PVS_MAX_ASPECT 2.4f          // 21:9; janelas mais largas desenham tudo
+#define PVS_WINDOW_HEIGHT_STEP 360
+#define PVS_SMALL_MESH_PIXELS 2.0f   // diâmetro projetado abaixo disso: visível pela esfera
+#define PVS_PIXELS_PER_FRAME (4 * 1024 * 1024)
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t numMeshes;
+    uint32_t meshHash;   // contagens e caixas das malhas finais (muda com --merge-meshes)
+    uint32_t yawCells, pitchCells;
+    float aspect;          // proporção do frustum alargado (PVS_MAX_ASPECT)
+    uint32_t windowHeight; // densidade da montagem: vale para janelas até essa altura
+    float eye[3];
+} PvsCacheHeader;
+
+typedef struct {
+    const Model* model;
+    uint32_t meshHash;
+    int windowHeight;          // altura (já arredondada) cuja densidade a montagem cobre
+    float windowAspect;        // da janela atual; acima de PVS_MAX_ASPECT o PVS não vale
+    int failed;                // sem FBO ou alvo grande demais: desenha tudo
+    unsigned int bytesPerCell;
+    unsigned char* bits;       // PVS_YAW_CELLS * PVS_PITCH_CELLS células x bytesPerCell
+    unsigned char* cellReady;
+    unsigned int cellsReady;
+    int saved;
+
+    // Alvo da montagem (FBO próprio)
+    int width, height;
+    GLuint framebuffer, colorBuffer, depthBuffer;
+    unsigned char* pixels;
+} PvsState;
+
+int pvsEnabled = 1; // --no-pvs desliga
+static PvsState pvs;
+
+static uint32_t pvsMeshHash(const Model* model) {
+    uint32_t h = 2166136261u;
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        const Mesh* mesh = &model->meshes[i];
+        uint32_t words[8] = { mesh->numVertices, mesh->numIndices };
+        memcpy(&words[2], mesh->boundsMin, sizeof(vec3));
+        memcpy(&words[5], mesh->boundsMax, sizeof(vec3));
+        for (int w = 0; w < 8; w++) { h ^= words[w]; h *= 16777619u; }
+    }
+    return h;
+}
+
+static void pvsPathFor(const Model* model, char* out, size_t outSize) {
+    snprintf(out, outSize, "%s.pvs", model->path);
+}
+
+static unsigned int pvsCellOf(const vec3 front) {
+    float yaw = glm_deg(atan2f(front[2], front[0]));
+    float pitch = glm_deg(asinf(glm_clamp(front[1], -1.0f, 1.0f)));
+    if (yaw < 0.0f) yaw += 360.0f;
+    int yawCell = (int)(yaw / PVS_CELL_DEGREES) % PVS_YAW_CELLS;
+    int pitchCell = (int)((pitch + 90.0f) / PVS_CELL_DEGREES);
+    if (pitchCell < 0) pitchCell = 0;
+    if (pitchCell >= PVS_PITCH_CELLS) pitchCell = PVS_PITCH_CELLS - 1;
+    return (unsigned int)(pitchCell * PVS_YAW_CELLS + yawCell);
+}
+
+// Projeção da montagem: a de renderScene (45° vertical) alargada, nos dois eixos, pelo
+// maior desvio angular dentro da célula (meia célula em yaw e em pitch) mais uma margem.
+static void pvsBakeProjection(float aspect, mat4 projection, float* bakeAspect) {
+    float widen = glm_rad(PVS_CELL_DEGREES * 0.5f * 1.41421356f + PVS_MARGIN_DEGREES);
+    float halfV = glm_rad(22.5f) + widen;
+    float halfH = atanf(aspect * tanf(glm_rad(22.5f))) + widen;
+    if (halfH > glm_rad(80.0f)) halfH = glm_rad(80.0f);
+    *bakeAspect = tanf(halfH) / tanf(halfV);
+    glm_perspective(2.0f * halfV, *bakeAspect, 0.1f, 1000.0f, projection);
+}
+
+static void pvsDeleteFramebuffer(void) {
+    if (pvs.framebuffer) glDeleteFramebuffers(1, &pvs.framebuffer);
+    if (pvs.colorBuffer) glDeleteRenderbuffers(1, &pvs.colorBuffer);
+    if (pvs.depthBuffer) glDeleteRenderbuffers(1, &pvs.depthBuffer);
+    pvs.framebuffer = pvs.colorBuffer = pvs.depthBuffer = 0;
+}
+
+static void pvsReleaseTarget(void) {
+    pvsDeleteFramebuffer();
+    free(pvs.pixels);
+    pvs.pixels = NULL;
+}
+
+// FBO com renderbuffers de cor e profundidade (GL 3.0). O alvo é maior que a janela,
+// então sem FBO (ou acima dos limites do driver) não há como montar: 0.
+static int pvsCreateTarget(int width, int height) {
+    pvsReleaseTarget();
+    if (!GLAD_GL_VERSION_3_0) {
+        fprintf(stderr, "Aviso: PVS exige GL 3.0 (FBO); desenhando a sala inteira\n");
+        return 0;
+    }
+    GLint maxSize = 0, maxViewport[2] = { 0, 0 };
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxSize);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewport);
+    if (width > maxSize || height > maxSize || width > maxViewport[0] || height > maxViewport[1]) {
+        fprintf(stderr, "Aviso: alvo do PVS (%dx%d) acima do limite do driver; desenhando a sala inteira\n", width, height);
+        return 0;
+    }
+    pvs.pixels = (unsigned char*)malloc((size_t)width * height * 4);
+    if (!pvs.pixels) return 0;
+    pvs.width = width;
+    pvs.height = height;
+
+    glGenRenderbuffers(1, &pvs.colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, pvs.colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &pvs.depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, pvs.depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glGenFramebuffers(1, &pvs.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, pvs.framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, pvs.colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, pvs.depthBuffer);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Aviso: FBO do PVS incompleto (0x%x); desenhando a sala inteira\n", status);
+        pvsReleaseTarget();
+        return 0;
+    }
+    return 1;
+}
+
+static int pvsLoad(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    PvsCacheHeader header;
+    size_t cells = PVS_YAW_CELLS * PVS_PITCH_CELLS;
+    int ok = fread(&header, sizeof(header), 1, f) == 1
+        && memcmp(header.magic, PVS_CACHE_MAGIC, sizeof(header.magic)) == 0
+        && header.version == PVS_CACHE_VERSION
+        && header.numMeshes == pvs.model->numMeshes
+        && header.meshHash == pvs.meshHash
+        && header.yawCells == PVS_YAW_CELLS && header.pitchCells == PVS_PITCH_CELLS
+        && fabsf(header.aspect - PVS_MAX_ASPECT) < 0.001f
+        && (int)header.windowHeight >= pvs.windowHeight
+        && memcmp(header.eye, cameraPos, sizeof(header.eye)) == 0
+        && fread(pvs.bits, pvs.bytesPerCell, cells, f) == cells;
+    fclose(f);
+    if (!ok) return 0;
+    pvs.windowHeight = (int)header.windowHeight;
+    memset(pvs.cellReady, 1, cells);
+    pvs.cellsReady = (unsigned int)cells;
+    pvs.saved = 1;
+    return 1;
+}
+
+static void pvsSave(const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (!f) { fprintf(stderr, "Aviso: não foi possível gravar %s\n", path); return; }
+    PvsCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PVS_CACHE_MAGIC, sizeof(header.magic));
+    header.version = PVS_CACHE_VERSION;
+    header.numMeshes = pvs.model->numMeshes;
+    header.meshHash = pvs.meshHash;
+    header.yawCells = PVS_YAW_CELLS;
+    header.pitchCells = PVS_PITCH_CELLS;
+    header.aspect = PVS_MAX_ASPECT;
+    header.windowHeight = (uint32_t)pvs.windowHeight;
+    memcpy(header.eye, cameraPos, sizeof(header.eye));
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(pvs.bits, pvs.bytesPerCell, PVS_YAW_CELLS * PVS_PITCH_CELLS, f);
+    if (fclose(f) != 0) { remove(path); fprintf(stderr, "Aviso: não foi possível gravar %s\n", path); return; }
+    printf("PVS gravado: %s (%u células, %u malhas)\n", path, PVS_YAW_CELLS * PVS_PITCH_CELLS, pvs.model->numMeshes);
+}
+
+// Desenha a sala com a cor = índice + 1 de cada malha na direção central da célula e
+// marca as malhas que sobraram em algum pixel, mais as que podem cair entre os pixels
+static void pvsBakeCell(unsigned int cell, mat4 projection, float pixelsPerTan) {
+    float yaw = glm_rad(((cell % PVS_YAW_CELLS) + 0.5f) * PVS_CELL_DEGREES);
+    float pitch = glm_rad(-90.0f + ((cell / PVS_YAW_CELLS) + 0.5f) * PVS_CELL_DEGREES);
+    vec3 front = { cosf(yaw) * cosf(pitch), sinf(pitch), sinf(yaw) * cosf(pitch) };
+    vec3 center;
+    mat4 view;
+    glm_vec3_add(cameraPos, front, center);
+    glm_lookat(cameraPos, center, cameraUp, view);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, pvs.framebuffer);
+    glViewport(0, 0, pvs.width, pvs.height);
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_BLEND);
+    glDisable(GL_DITHER);
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadMatrixf((const GLfloat*)projection);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadMatrixf((const GLfloat*)view);
+
+    Model* model = (Model*)pvs.model;
+    RenderBackend backend = RenderBackend_Effective();
+    modelBeginArrays(backend);
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        unsigned int id = i + 1;
+        glColor3ub((GLubyte)(id & 0xFF), (GLubyte)((id >> 8) & 0xFF), (GLubyte)((id >> 16) & 0xFF));
+        meshDrawGeometry(&model->meshes[i], backend);
+    }
+    modelEndArrays(backend);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, pvs.width, pvs.height, GL_RGBA, GL_UNSIGNED_BYTE, pvs.pixels);
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopAttrib();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    unsigned char* bits = &pvs.bits[(size_t)cell * pvs.bytesPerCell];
+    memset(bits, 0, pvs.bytesPerCell);
+    const unsigned char* p = pvs.pixels;
+    for (int k = 0; k < pvs.width * pvs.height; k++, p += 4) {
+        unsigned int id = p[0] | (p[1] << 8) | (p[2] << 16);
+        if (id > 0 && id <= model->numMeshes) bits[(id - 1) >> 3] |= (unsigned char)(1u << ((id - 1) & 7));
+    }
+
+    // Uma malha menor que ~um pixel pode não cobrir o centro de nenhum: entra se a esfera
+    // toca o frustum da célula (sem saber se está escondida)
+    mat4 viewProjection;
+    vec4 planes[6];
+    glm_mat4_mul(projection, view, viewProjection);
+    glm_frustum_planes(viewProjection, planes);
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        if (bits[i >> 3] & (1u << (i & 7))) continue;
+        const float* sphere = model->meshes[i].boundingSphere;
+        float distance = glm_vec3_distance((float*)sphere, cameraPos);
+        if (distance <= sphere[3]) continue; // envolve o olho: grande, a rasterização já viu
+        if (2.0f * sphere[3] / distance * pixelsPerTan >= PVS_SMALL_MESH_PIXELS) continue;
+        if (glm_sphere_frustum((float*)sphere, planes)) bits[i >> 3] |= (unsigned char)(1u << (i & 7));
+    }
+}
+
+// Chamado por quadro com o modelo pronto: (re)começa quando modelo ou malhas mudam ou a
+// janela fica mais alta que a densidade montada, tenta o arquivo e monta algumas
+// células; grava quando todas ficam prontas
+void Pvs_Update(const Model* model, int windowWidth, int windowHeight) {
+    uint32_t hash = pvsMeshHash(model);
+    int heightStep = (windowHeight + PVS_WINDOW_HEIGHT_STEP - 1) / PVS_WINDOW_HEIGHT_STEP;
+    int bakeWindowHeight = (heightStep > 0 ? heightStep : 1) * PVS_WINDOW_HEIGHT_STEP;
+    char path[1040];
+    pvsPathFor(model, path, sizeof(path));
+    pvs.windowAspect = (float)windowWidth / (float)windowHeight;
+    if (pvs.model != model || pvs.meshHash != hash || windowHeight > pvs.windowHeight) {
+        size_t cells = PVS_YAW_CELLS * PVS_PITCH_CELLS;
+        pvs.model = model;
+        pvs.meshHash = hash;
+        pvs.windowHeight = bakeWindowHeight;
+        pvs.failed = 0;
+        pvs.bytesPerCell = (model->numMeshes + 7) / 8;
+        free(pvs.bits);
+        free(pvs.cellReady);
+        pvs.bits = (unsigned char*)calloc(cells, pvs.bytesPerCell ? pvs.bytesPerCell : 1);
+        pvs.cellReady = (unsigned char*)calloc(cells, 1);
+        pvs.cellsReady = 0;
+        pvs.saved = 0;
+        if (pvsLoad(path)) {
+            printf("PVS carregado de %s\n", path);
+            return;
+        }
+        printf("Montando PVS de %s (%u células)...\n", model->path, (unsigned int)cells);
+    }
+    if (pvs.saved || pvs.failed) return;
+
+    // Pixels por unidade de tangente da janela (45° vertical); a montagem usa a mesma
+    // densidade sobre o frustum alargado
+    mat4 projection;
+    float bakeAspect;
+    pvsBakeProjection(PVS_MAX_ASPECT, projection, &bakeAspect);
+    float pixelsPerTan = pvs.windowHeight / (2.0f * tanf(glm_rad(22.5f)));
+    int height = (int)ceilf(2.0f / projection[1][1] * pixelsPerTan); // [1][1] = 1/tan(meio ângulo vertical)
+    int width = (int)ceilf(height * bakeAspect);
+    if (!pvs.pixels || pvs.width != width || pvs.height != height) {
+        if (!pvsCreateTarget(width, height)) {
+            pvs.failed = 1;
+            return;
+        }
+        printf("PVS: montagem em %dx%d (janelas até %d px de altura)\n", width, height, pvs.windowHeight);
+    }
+
+    unsigned int total = PVS_YAW_CELLS * PVS_PITCH_CELLS;
+    unsigned int cellsPerFrame = PVS_PIXELS_PER_FRAME / ((unsigned int)width * height);
+    if (cellsPerFrame < 1) cellsPerFrame = 1;
+    for (unsigned int baked = 0, cell = 0; cell < total && baked < cellsPerFrame; cell++) {
+        if (pvs.cellReady[cell]) continue;
+        pvsBakeCell(cell, projection, pixelsPerTan);
+        pvs.cellReady[cell] = 1;
+        pvs.cellsReady++;
+        baked++;
+    }
+    if (pvs.cellsReady == total) {
+        pvsSave(path);
+        pvs.saved = 1;
+        pvsReleaseTarget();
+    }
+}
+
+// Bits (um por malha) da célula da direção dada, ou NULL se a célula ainda não foi montada
+// ou a janela é mais larga que o frustum montado
+const unsigned char* Pvs_VisibleSet(const vec3 front) {
+    if (!pvs.model || pvs.failed || pvs.model->numMeshes == 0 || pvs.windowAspect > PVS_MAX_ASPECT) return NULL;
+    unsigned int cell = pvsCellOf(front);
+    return pvs.cellReady[cell] ? &pvs.bits[(size_t)cell * pvs.bytesPerCell] : NULL;
+}
+
+int Pvs_Progress(unsigned int* ready, unsigned int* total) {
+    *ready = pvs.cellsReady;
+    *total = PVS_YAW_CELLS * PVS_PITCH_CELLS;
+    return pvs.model != NULL && !pvs.failed;
+}
+
+void Pvs_Shutdown(void) {
+    pvsReleaseTarget();
+    free(pvs.bits);
+    free(pvs.cellReady);
+    memset(&pvs, 0, sizeof(pvs));
+}
+
+// ---- Sala em cubemap (impostor) ----
+// A câmera só gira em torno de cameraPos, então a sala estática pode ser desenhada uma vez
+// nas seis faces de um cubemap de cor e outro de profundidade. A cada quadro um único quad
+// de tela cheia busca a cor pela direção do pixel e converte a profundidade da face para a
+// projeção atual (gl_FragDepth), e bonecos, martelo e HUD são desenhados por cima com
+// oclusão correta. Exige GL 3.0 (FBO e cubemap de profundidade) e GLSL 1.20; sem isso a
+// sala volta a ser desenhada normalmente.
+
+#define ROOM_CUBEMAP_NEAR 0.1f
+#define ROOM_CUBEMAP_FAR 1000.0f
+#define ROOM_CUBEMAP_MAX_FACE 2048 // 6 x 2048² x 8 bytes = 192 MB de cor + profundidade
+
+typedef struct {
+    GLuint colorCube, depthCube, framebuffer;
+    GLuint program;
+    GLint uInverseViewProjection, uViewProjection, uEye, uNearFar, uColorCube, uDepthCube;
+    int faceSize;               // 0 = não montado
+    RoomCubemapQuality quality; // qualidade usada na montagem
+    int screenHeight;           // altura da janela usada na montagem
+    const Model* model;
+    unsigned int textureGeneration; // TextureLoader_Generation() da montagem
+    int allocationFailed;       // texturas/FBO de quality x screenHeight não couberam
+    int failed;                 // sem GL 3.0 ou shader: não tenta de novo
+} RoomCubemap;
+
+RoomCubemapQuality roomCubemapQuality = ROOM_CUBEMAP_OFF;
+static RoomCubemap roomCubemap;
+
+static const char* roomCubemapQualityNames[ROOM_CUBEMAP_LEVELS] = { "desligado", "low", "medium", "high" };
+// Fração da densidade de pixels do centro da tela: face = altura / tan(22,5°) * escala
+static const float roomCubemapQualityScale[ROOM_CUBEMAP_LEVELS] = { 0.0f, 0.25f, 0.5f, 1.0f };
+
+const char* RoomCubemap_QualityName(RoomCubemapQuality quality) {
+    return roomCubemapQualityNames[quality];
+}
+
+int RoomCubemap_FaceSize(void) {
+    return roomCubemap.faceSize;
+}
+
+static const char* roomCubemapVertexSource =
+    "#version 120\n"
+    "uniform mat4 inverseViewProjection;\n"
+    "uniform vec3 eye;\n"
+    "varying vec3 ray;\n"
+    "void main() {\n"
+    "    vec4 farPoint = inverseViewProjection * vec4(gl_Vertex.xy, 1.0, 1.0);\n"
+    "    ray = farPoint.xyz / farPoint.w - eye;\n"
+    "    gl_Position = vec4(gl_Vertex.xy, 0.0, 1.0);\n"
+    "}\n";
+
+// Profundidade da face -> distância ao longo do eixo da face -> ponto no mundo -> profundidade
+// na projeção do quadro
+static const char* roomCubemapFragmentSource =
+    "#version 120\n"
+    "uniform samplerCube colorCube;\n"
+    "uniform samplerCube depthCube;\n"
+    "uniform mat4 viewProjection;\n"
+    "uniform vec3 eye;\n"
+    "uniform vec2 nearFar;\n"
+    "varying vec3 ray;\n"
+    "void main() {\n"
+    "    vec3 dir = normalize(ray);\n"
+    "    gl_FragColor = textureCube(colorCube, dir);\n"
+    "    float depth = textureCube(depthCube, dir).r;\n"
+    "    if (depth >= 1.0) { gl_FragDepth = 1.0; return; }\n"
+    "    float n = nearFar.x, f = nearFar.y;\n"
+    "    float axisDistance = 2.0 * n * f / ((f + n) - (2.0 * depth - 1.0) * (f - n));\n"
+    "    vec3 a = abs(dir);\n"
+    "    vec3 world = eye + dir * (axisDistance / max(a.x, max(a.y, a.z)));\n"
+    "    vec4 clip = viewProjection * vec4(world, 1.0);\n"
+    "    gl_FragDepth = clamp(0.5 * clip.z / clip.w + 0.5, 0.0, 1.0);\n"
+    "}\n";
+
+static GLuint compileShader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint ok = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        fprintf(stderr, "ERRO::SHADER:: %s\n", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// attributes (ou NULL): nomes ligados aos índices firstAttribute, firstAttribute + 1, ...
+static GLuint linkProgram(const char* vertexSource, const char* fragmentSource, const char* const* attributes, GLuint firstAttribute) {
+    GLuint vs = compileShader(GL_VERTEX_SHADER, vertexSource);
+    GLuint fs = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    if (!vs || !fs) {
+        if (vs) glDeleteShader(vs);
+        if (fs) glDeleteShader(fs);
+        return 0;
+    }
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    for (GLuint i = 0; attributes && attributes[i]; i++) glBindAttribLocation(program, firstAttribute + i, attributes[i]);
+    glLinkProgram(program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    GLint ok = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        fprintf(stderr, "ERRO::SHADER:: %s\n", log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+static void roomCubemapReleaseTextures(void) {
+    if (roomCubemap.framebuffer) glDeleteFramebuffers(1, &roomCubemap.framebuffer);
+    if (roomCubemap.colorCube) glDeleteTextures(1, &roomCubemap.colorCube);
+    if (roomCubemap.depthCube) glDeleteTextures(1, &roomCubemap.depthCube);
+    roomCubemap.framebuffer = roomCubemap.colorCube = roomCubemap.depthCube = 0;
+    roomCubemap.faceSize = 0;
+}
+
+static int roomCubemapCreateTextures(int size) {
+    roomCubemapReleaseTextures();
+    while (glGetError() != GL_NO_ERROR) {} // erros antigos não contam como falta de memória
+    glGenTextures(1, &roomCubemap.colorCube);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, roomCubemap.colorCube);
+    for (int face = 0; face < 6; face++) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    // Profundidade sem filtro: interpolar entre bordas de objetos cria superfícies falsas
+    glGenTextures(1, &roomCubemap.depthCube);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, roomCubemap.depthCube);
+    for (int face = 0; face < 6; face++) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    glGenFramebuffers(1, &roomCubemap.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, roomCubemap.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X, roomCubemap.colorCube, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X, roomCubemap.depthCube, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (glGetError() == GL_OUT_OF_MEMORY) {
+        fprintf(stderr, "Aviso: sem memória para o cubemap da sala (%d px por face)\n", size);
+        roomCubemapReleaseTextures();
+        return 0;
+    }
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Aviso: FBO do cubemap da sala incompleto (0x%x)\n", status);
+        roomCubemapReleaseTextures();
+        return 0;
+    }
+    roomCubemap.faceSize = size;
+    return 1;
+}
+
+// Desenha a sala inteira (sem culling: a face cobre direções fora da tela) nas seis faces
+static void roomCubemapBake(Model* model) {
+    // Orientação padrão das faces de cubemap do GL (+X, -X, +Y, -Y, +Z, -Z)
+    static const float faceDirs[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    static const float faceUps[6][3] = { { 0, -1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, -1, 0 }, { 0, -1, 0 } };
+    mat4 projection, view;
+    glm_perspective(glm_rad(90.0f), 1.0f, ROOM_CUBEMAP_NEAR, ROOM_CUBEMAP_FAR, projection);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, roomCubemap.framebuffer);
+    glViewport(0, 0, roomCubemap.faceSize, roomCubemap.faceSize);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadMatrixf((const GLfloat*)projection);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glClearColor(0.2f, 0.3f, 0.5f, 1.0f); // o mesmo céu de renderScene
+    for (int face = 0; face < 6; face++) {
+        vec3 center, up;
+        glm_vec3_add(cameraPos, (float*)faceDirs[face], center);
+        glm_vec3_copy((float*)faceUps[face], up);
+        glm_lookat(cameraPos, center, up, view);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, roomCubemap.colorCube, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, roomCubemap.depthCube, 0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glLoadMatrixf((const GLfloat*)view);
+        applySceneLighting();
+        Model_Draw(model);
+    }
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Garante o cubemap da qualidade e janela atuais; 1 se a sala pode vir dele neste quadro
+int RoomCubemap_Update(Model* model, int screenHeight) {
+    if (roomCubemap.failed) return 0;
+    if (!GLAD_GL_VERSION_3_0) {
+        fprintf(stderr, "Aviso: cubemap da sala exige GL 3.0; desenhando a sala normalmente\n");
+        roomCubemap.failed = 1;
+        return 0;
+    }
+    if (!roomCubemap.program) {
+        roomCubemap.program = linkProgram(roomCubemapVertexSource, roomCubemapFragmentSource, NULL, 0);
+        if (!roomCubemap.program) { roomCubemap.failed = 1; return 0; }
+        roomCubemap.uInverseViewProjection = glGetUniformLocation(roomCubemap.program, "inverseViewProjection");
+        roomCubemap.uViewProjection = glGetUniformLocation(roomCubemap.program, "viewProjection");
+        roomCubemap.uEye = glGetUniformLocation(roomCubemap.program, "eye");
+        roomCubemap.uNearFar = glGetUniformLocation(roomCubemap.program, "nearFar");
+        roomCubemap.uColorCube = glGetUniformLocation(roomCubemap.program, "colorCube");
+        roomCubemap.uDepthCube = glGetUniformLocation(roomCubemap.program, "depthCube");
+    }
+    // Enquanto há texturas a caminho a sala é desenhada normalmente: montar agora
+    // congelaria as placeholders 1x1 no cubemap
+    if (TextureLoader_Pending() > 0) return 0;
+    unsigned int textureGeneration = TextureLoader_Generation();
+    if (roomCubemap.faceSize && roomCubemap.quality == roomCubemapQuality
+        && roomCubemap.screenHeight == screenHeight && roomCubemap.model == model
+        && roomCubemap.textureGeneration == textureGeneration) {
+        return 1;
+    }
+    // Já falhou com esta qualidade e janela: só tenta de novo quando uma delas mudar
+    if (roomCubemap.allocationFailed && roomCubemap.quality == roomCubemapQuality
+        && roomCubemap.screenHeight == screenHeight) {
+        return 0;
+    }
+
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_CUBE_MAP_TEXTURE_SIZE, &maxSize);
+    int size = (int)(screenHeight / tanf(glm_rad(22.5f)) * roomCubemapQualityScale[roomCubemapQuality]);
+    if (size > maxSize) size = maxSize;
+    if (size > ROOM_CUBEMAP_MAX_FACE) size = ROOM_CUBEMAP_MAX_FACE;
+    if (size < 64) size = 64;
+
+    uint64_t start = Clock_NowNs();
+    roomCubemap.allocationFailed = 0;
+    if (size != roomCubemap.faceSize && !roomCubemapCreateTextures(size)) {
+        // Sala desenhada normalmente; faceSize já voltou a 0
+        roomCubemap.allocationFailed = 1;
+        roomCubemap.quality = roomCubemapQuality;
+        roomCubemap.screenHeight = screenHeight;
+        return 0;
+    }
+    roomCubemapBake(model);
+    roomCubemap.quality = roomCubemapQuality;
+    roomCubemap.screenHeight = screenHeight;
+    roomCubemap.model = model;
+    roomCubemap.textureGeneration = textureGeneration;
+    printf("Cubemap da sala (%s): %d px por face, %.1f MB, montado em %.2f ms\n",
+           RoomCubemap_QualityName(roomCubemapQuality), size, 6.0 * size * size * 8 / (1024.0 * 1024.0),
+           (Clock_NowNs() - start) / 1e6);
+    return 1;
+}
+
+// Quad de tela cheia: cor da sala e profundidade equivalente à da geometria real
+void RoomCubemap_Draw(mat4 projection, mat4 view) {
+    mat4 viewProjection, inverseViewProjection;
+    glm_mat4_mul(projection, view, viewProjection);
+    glm_mat4_inv(viewProjection, inverseViewProjection);
+
+    glPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT | GL_TEXTURE_BIT);
+    glDisable(GL_LIGHTING);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_ALWAYS);
+    glDepthMask(GL_TRUE);
+    glUseProgram(roomCubemap.program);
+    glUniformMatrix4fv(roomCubemap.uInverseViewProjection, 1, GL_FALSE, (const GLfloat*)inverseViewProjection);
+    glUniformMatrix4fv(roomCubemap.uViewProjection, 1, GL_FALSE, (const GLfloat*)viewProjection);
+    glUniform3fv(roomCubemap.uEye, 1, cameraPos);
+    glUniform2f(roomCubemap.uNearFar, ROOM_CUBEMAP_NEAR, ROOM_CUBEMAP_FAR);
+    glUniform1i(roomCubemap.uColorCube, 0);
+    glUniform1i(roomCubemap.uDepthCube, 1);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, roomCubemap.depthCube);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, roomCubemap.colorCube);
+
+    glBegin(GL_QUADS);
+    glVertex2f(-1.0f, -1.0f);
+    glVertex2f( 1.0f, -1.0f);
+    glVertex2f( 1.0f,  1.0f);
+    glVertex2f(-1.0f,  1.0f);
+    glEnd();
+
+    glUseProgram(0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    glPopAttrib();
+}
+
+void RoomCubemap_Shutdown(void) {
+    roomCubemapReleaseTextures();
+    if (roomCubemap.program) glDeleteProgram(roomCubemap.program);
+    memset(&roomCubemap, 0, sizeof(roomCubemap));
+}
+
+// ---- Primitivas em cache ----
+// Esfera das cabeças, cilindros do martelo e cubo (cabeça do martelo e tronco reserva)
+// tesselados uma vez, no mesmo formato das malhas dos modelos, e desenhados pelo backend
+// atual. A geometria repete a do gluSphere/gluCylinder/glutSolidCube que substituem
+// (mesmos eixos, normais e UVs), então a textura das cabeças cai no mesmo lugar.
+
+int primitiveDetail = 32; // fatias e pilhas da esfera; os cilindros usam metade (--primitive-detail)
+
+static unsigned char* primitiveArena = NULL; // malhas de PRIMITIVE_COUNT, um free só
+static Mesh* primitiveMeshes = NULL;
+
+static void primitiveSetVertex(Vertex* v, float px, float py, float pz, float nx, float ny, float nz, float s, float t) {
+    v->position[0] = px; v->position[1] = py; v->position[2] = pz;
+    v->normal[0] = nx; v->normal[1] = ny; v->normal[2] = nz;
+    v->texCoords[0] = s; v->texCoords[1] = t;
+}
+
+// Faixa de quads entre duas fileiras de (columns + 1) vértices, em triângulos.
+// Cada quad é (a, b, b+1, a+1), na ordem em que o GL_QUAD_STRIP do GLU os monta.
+static void primitiveStripIndices(Mesh* mesh, unsigned int* written, unsigned int rowA, unsigned int rowB, unsigned int columns) {
+    for (unsigned int i = 0; i < columns; i++) {
+        unsigned int quad[6] = { rowA + i, rowB + i, rowB + i + 1, rowA + i, rowB + i + 1, rowA + i + 1 };
+        for (int k = 0; k < 6; k++) Mesh_SetIndex(mesh, (*written)++, quad[k]);
+    }
+}
+
+// Esfera de raio 1 em torno do eixo Z, como gluSphere com GLU_OUTSIDE e textura:
+// fileira j no ângulo polar pi*j/stacks, coluna i no azimute 2*pi*i/slices (a última
+// repete a primeira com s = 0), UV (1 - i/slices, 1 - j/stacks)
+static void primitiveBuildSphere(Mesh* mesh, unsigned int slices, unsigned int stacks) {
+    for (unsigned int j = 0; j <= stacks; j++) {
+        float rho = (float)GLM_PI * j / stacks;
+        float ringRadius = (j == 0 || j == stacks) ? 0.0f : sinf(rho); // fecha nos polos
+        float ringNormal = sinf(rho);
+        for (unsigned int i = 0; i <= slices; i++) {
+            float theta = (i == slices) ? 0.0f : 2.0f * (float)GLM_PI * i / slices;
+            primitiveSetVertex(&mesh->vertices[j * (slices + 1) + i],
+                               ringRadius * sinf(theta), ringRadius * cosf(theta), cosf(rho),
+                               ringNormal * sinf(theta), ringNormal * cosf(theta), cosf(rho),
+                               1.0f - (float)i / slices, 1.0f - (float)j / stacks);
+        }
+    }
+    unsigned int written = 0;
+    for (unsigned int j = 0; j < stacks; j++) {
+        primitiveStripIndices(mesh, &written, (j + 1) * (slices + 1), j * (slices + 1), slices);
+    }
+    mesh->keepTexCoords = 1;
+}
+
+// Tronco de cone ao longo de +Z, de z = 0 (baseRadius) a z = height (topRadius), sem
+// tampas, como gluCylinder com uma pilha
+static void primitiveBuildCylinder(Mesh* mesh, float baseRadius, float topRadius, float height, unsigned int slices) {
+    float deltaRadius = baseRadius - topRadius;
+    float length = sqrtf(deltaRadius * deltaRadius + height * height);
+    float zNormal = deltaRadius / length;
+    float xyNormal = height / length;
+    for (unsigned int i = 0; i <= slices; i++) {
+        float theta = (i == slices) ? 0.0f : 2.0f * (float)GLM_PI * i / slices;
+        float s = sinf(theta), c = cosf(theta);
+        primitiveSetVertex(&mesh->vertices[i], baseRadius * s, baseRadius * c, 0.0f,
+                           xyNormal * s, xyNormal * c, zNormal, 1.0f - (float)i / slices, 0.0f);
+        primitiveSetVertex(&mesh->vertices[slices + 1 + i], topRadius * s, topRadius * c, height,
+                           xyNormal * s, xyNormal * c, zNormal, 1.0f - (float)i / slices, 1.0f);
+    }
+    unsigned int written = 0;
+    primitiveStripIndices(mesh, &written, 0, slices + 1, slices);
+}
+
+// Cubo de lado 1 centrado na origem, quatro vértices por face (normal da face).
+// Por face: normal n e eixos u, v com u x v = n, para os cantos saírem anti-horários.
+static void primitiveBuildCube(Mesh* mesh) {
+    static const float faces[6][3][3] = {
+        { { 1, 0, 0}, {0, 1, 0}, {0, 0, 1} },
+        { {-1, 0, 0}, {0, 0, 1}, {0, 1, 0} },
+        { { 0, 1, 0}, {0, 0, 1}, {1, 0, 0} },
+        { { 0,-1, 0}, {1, 0, 0}, {0, 0, 1} },
+        { { 0, 0, 1}, {1, 0, 0}, {0, 1, 0} },
+        { { 0, 0,-1}, {0, 1, 0}, {1, 0, 0} },
+    };
+    static const float corners[4][2] = { {-0.5f, -0.5f}, {0.5f, -0.5f}, {0.5f, 0.5f}, {-0.5f, 0.5f} };
+    static const unsigned int quad[6] = { 0, 1, 2, 0, 2, 3 };
+    unsigned int written = 0;
+    for (unsigned int f = 0; f < 6; f++) {
+        const float* n = faces[f][0];
+        const float* u = faces[f][1];
+        const float* v = faces[f][2];
+        for (unsigned int k = 0; k < 4; k++) {
+            float a = corners[k][0], b = corners[k][1];
+            primitiveSetVertex(&mesh->vertices[f * 4 + k],
+                               n[0] * 0.5f + u[0] * a + v[0] * b,
+                               n[1] * 0.5f + u[1] * a + v[1] * b,
+                               n[2] * 0.5f + u[2] * a + v[2] * b,
+                               n[0], n[1], n[2], a + 0.5f, b + 0.5f);
+        }
+        for (int k = 0; k < 6; k++) Mesh_SetIndex(mesh, written++, f * 4 + quad[k]);
+    }
+}
+
+// Monta todas as primitivas num arena só; chamada no primeiro desenho
+static void primitiveCacheBuild(void) {
+    unsigned int sphereSlices = (unsigned int)primitiveDetail;
+    unsigned int cylinderSlices = sphereSlices / 2 < 4 ? 4 : sphereSlices / 2;
+    MeshArenaSizes sizes[PRIMITIVE_COUNT];
+    memset(sizes, 0, sizeof(sizes));
+    sizes[PRIMITIVE_SPHERE].numVertices = (sphereSlices + 1) * (sphereSlices + 1);
+    sizes[PRIMITIVE_SPHERE].numIndices = sphereSlices * sphereSlices * 6;
+    sizes[PRIMITIVE_HANDLE].numVertices = sizes[PRIMITIVE_TIP].numVertices = 2 * (cylinderSlices + 1);
+    sizes[PRIMITIVE_HANDLE].numIndices = sizes[PRIMITIVE_TIP].numIndices = cylinderSlices * 6;
+    sizes[PRIMITIVE_CUBE].numVertices = 24;
+    sizes[PRIMITIVE_CUBE].numIndices = 36;
+    for (int i = 0; i < PRIMITIVE_COUNT; i++) sizes[i].indexType = Mesh_IndexTypeFor(sizes[i].numVertices);
+
+    size_t arenaBytes;
+    primitiveArena = ModelArena_Create(sizes, PRIMITIVE_COUNT, &primitiveMeshes, NULL, &arenaBytes);
+    primitiveBuildSphere(&primitiveMeshes[PRIMITIVE_SPHERE], sphereSlices, sphereSlices);
+    primitiveBuildCylinder(&primitiveMeshes[PRIMITIVE_HANDLE], 0.15f, 0.15f, 2.5f, cylinderSlices);
+    primitiveBuildCylinder(&primitiveMeshes[PRIMITIVE_TIP], 0.15f, 0.18f, 0.3f, cylinderSlices);
+    primitiveBuildCube(&primitiveMeshes[PRIMITIVE_CUBE]);
+    for (int i = 0; i < PRIMITIVE_COUNT; i++) Mesh_ComputeBounds(&primitiveMeshes[i]);
+}
+
+Mesh* Primitive_Mesh(PrimitiveKind kind) {
+    if (!primitiveArena) primitiveCacheBuild();
+    return &primitiveMeshes[kind];
+}
+
+// Só a geometria: cor, textura e matriz ficam com quem chama
+void Primitive_Draw(PrimitiveKind kind) {
+    RenderBackend backend = RenderBackend_Effective();
+    Mesh* mesh = Primitive_Mesh(kind);
+    modelBeginArrays(backend);
+    meshDrawGeometry(mesh, backend);
+    modelEndArrays(backend);
+}
+
+void Primitive_Shutdown(void) {
+    if (!primitiveArena) return;
+    for (int i = 0; i < PRIMITIVE_COUNT; i++) Mesh_ReleaseGpu(&primitiveMeshes[i]);
+    free(primitiveArena);
+    primitiveArena = NULL;
+    primitiveMeshes = NULL;
+}
+
+// ---- Bonecos em lote ----
+// Em vez de desenhar boneco por boneco (atributos, textura, matriz e o MEN.obj inteiro
+// para cada um), cada quadro monta a lista das instâncias visíveis (posição, yaw do
+// billboard, cor do tipo e textura da cabeça) agrupada pela textura da cabeça. Com GL 3.3
+// e backend VBO, cada malha do tronco vira um glDrawElementsInstanced para todos os
+// bonecos e as cabeças um por textura: a posição e o giro saem de atributos com divisor 1
+// num shader que repete a iluminação fixa da cena. Sem isso (ou com --no-instancing) a
+// mesma lista é desenhada em lote pelo pipeline fixo: o material é trocado uma vez por
+// malha/textura e cada boneco só muda a matriz.
+
+#define BONECO_TYPES 4
+// Longe dos índices que alguns drivers reservam para gl_Vertex, gl_Normal, gl_Color...
+#define BONECO_ATTRIB_PLACEMENT 6
+#define BONECO_ATTRIB_COLOR 7
+
+// Medidas do boneco
+static const float bonecoTrunkWidth = 0.9f;
+static const float bonecoTrunkHeight = 1.4f;
+static const float bonecoTrunkDepth = 0.6f;
+static const float bonecoHeadRadius = 1.40f;
+static const float bonecoHeadForward = 0.3f; // cabeça um pouco à frente do tronco
+
+// Cor do tronco por tipo (verde, azul, vermelho, preto), na ordem de headTextures
+static const float bonecoTypeColors[BONECO_TYPES][3] = {
+    { 0.0f, 0.9f, 0.0f }, { 0.0f, 0.0f, 0.9f }, { 0.9f, 0.0f, 0.0f }, { 0.05f, 0.05f, 0.05f }
+};
+
+typedef struct {
+    vec4 placement; // x, y, z do boneco (offsets aplicados) e yaw do billboard da cabeça (rad)
+    vec3 color;     // cor do tipo: tronco em cubo e malhas texturizadas do MEN.obj
+    int headLayer;  // textura da cabeça (índice em headTextures)
+} BonecoInstance;
+
+typedef struct {
+    BonecoInstance* visible;   // instâncias do quadro na ordem dos slots
+    BonecoInstance* instances; // as mesmas agrupadas por headLayer (é o que vai para o buffer)
+    unsigned int capacity;     // cresce com numSlots; os quadros não alocam
+    unsigned int count;
+    unsigned int layerStart[BONECO_TYPES + 1];
+    GLuint instanceBuffer;
+    GLuint program;
+    GLint uPartMatrix, uPartNormalMatrix, uPartOffset, uBillboard, uLit, uTextured, uTexture;
+    int failed;                // shader não compilou: fica no caminho em lote
+} BonecoBatch;
+
+int bonecoInstancing = 1; // --no-instancing desliga
+static BonecoBatch bonecoBatch;
+
+// Cada peça é desenhada em placement + partOffset + giro(yaw) * partMatrix * vértice; o
+// giro só vale para a cabeça (billboard = 1). A luz é a do pipeline fixo com
+// GL_COLOR_MATERIAL (ambiente e difusa seguem a cor), sem especular, por vértice.
+static const char* bonecoVertexSource =
+    "#version 120\n"
+    "attribute vec4 instancePlacement;\n"
+    "attribute vec3 instanceColor;\n"
+    "uniform mat4 partMatrix;\n"
+    "uniform mat4 partNormalMatrix;\n"
+    "uniform vec3 partOffset;\n"
+    "uniform float billboard;\n"
+    "uniform bool lit;\n"
+    "varying vec4 color;\n"
+    "varying vec2 uv;\n"
+    "void main() {\n"
+    "    float yaw = instancePlacement.w * billboard;\n"
+    "    float s = sin(yaw), c = cos(yaw);\n"
+    "    mat3 turn = mat3(c, 0.0, -s, 0.0, 1.0, 0.0, s, 0.0, c);\n"
+    "    vec3 world = instancePlacement.xyz + partOffset + turn * (partMatrix * gl_Vertex).xyz;\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vec4(world, 1.0);\n"
+    "    color = vec4(instanceColor, 1.0);\n"
+    "    if (lit) {\n"
+    "        vec3 n = gl_NormalMatrix * (turn * (mat3(partNormalMatrix) * gl_Normal));\n"
+    "        vec3 l = normalize(gl_LightSource[0].position.xyz);\n"
+    "        vec3 light = gl_LightModel.ambient.rgb + gl_LightSource[0].ambient.rgb\n"
+    "                   + gl_LightSource[0].diffuse.rgb * max(dot(n, l), 0.0);\n"
+    "        color.rgb = clamp(color.rgb * light, 0.0, 1.0);\n"
+    "    }\n"
+    "    uv = (gl_TextureMatrix[0] * gl_MultiTexCoord0).xy;\n"
+    "}\n";
+
+static const char* bonecoFragmentSource =
+    "#version 120\n"
+    "uniform bool textured;\n"
+    "uniform sampler2D texture0;\n"
+    "varying vec4 color;\n"
+    "varying vec2 uv;\n"
+    "void main() {\n"
+    "    gl_FragColor = textured ? color * texture2D(texture0, uv) : color;\n"
+    "}\n";
+
+// Tronco no espaço do boneco: MEN.obj girado e em escala 2, ou o cubo reserva
+static void bonecoTrunkMatrix(int hasTrunkModel, mat4 out) {
+    glm_mat4_identity(out);
+    glm_translate(out, (vec3){ 0.0f, -bonecoTrunkHeight * 0.7f, 0.0f });
+    if (hasTrunkModel) {
+        glm_rotate_y(out, glm_rad(90.0f), out);
+        glm_scale_uni(out, 2.0f);
+    } else {
+        glm_scale(out, (vec3){ bonecoTrunkWidth, bonecoTrunkHeight, bonecoTrunkDepth });
+    }
+}
+
+// Esfera da cabeça em torno do próprio centro; o -90° em X acerta a orientação da textura
+static void bonecoHeadMatrix(mat4 out) {
+    glm_mat4_identity(out);
+    glm_rotate_x(out, glm_rad(-90.0f), out);
+    glm_scale_uni(out, bonecoHeadRadius);
+}
+
+// Monta as instâncias visíveis de slots[first .. first + count) e as agrupa por textura
+static unsigned int bonecoGather(unsigned int first, unsigned int count, int hasTrunkModel, mat4 trunkMatrix) {
+    BonecoBatch* batch = &bonecoBatch;
+    if (batch->capacity < numSlots) {
+        free(batch->visible);
+        free(batch->instances);
+        batch->visible = (BonecoInstance*)malloc(numSlots * sizeof(BonecoInstance));
+        batch->instances = (BonecoInstance*)malloc(numSlots * sizeof(BonecoInstance));
+        batch->capacity = numSlots;
+    }
+
+    // Caixa do boneco no espaço dele (tronco transformado unido à cabeça), para o culling
+    vec3 local[2], box[2];
+    if (hasTrunkModel) {
+        Model_LocalBounds(menModel, local[0], local[1]);
+    } else {
+        glm_vec3_fill(local[0], -0.5f);
+        glm_vec3_fill(local[1], 0.5f);
+    }
+    glm_aabb_transform(local, trunkMatrix, box);
+    vec3 headMin = { -bonecoHeadRadius, bonecoTrunkHeight, bonecoHeadForward - bonecoHeadRadius };
+    vec3 headMax = { bonecoHeadRadius, bonecoTrunkHeight + 2.0f * bonecoHeadRadius, bonecoHeadForward + bonecoHeadRadius };
+    glm_vec3_minv(box[0], headMin, box[0]);
+    glm_vec3_maxv(box[1], headMax, box[1]);
+
+    unsigned int layerCount[BONECO_TYPES] = { 0 };
+    unsigned int visibleCount = 0;
+    for (unsigned int i = first; i < first + count; i++) {
+        vec3 position = { slots[i].pos[0] + slotOffsetX - 2.0f, slots[i].pos[1], slots[i].pos[2] + slotOffsetZ };
+        if (frustumCulling) {
+            vec3 worldBox[2];
+            glm_vec3_add(box[0], position, worldBox[0]);
+            glm_vec3_add(box[1], position, worldBox[1]);
+            cullStats.bonecosTested++;
+            if (!glm_aabb_frustum(worldBox, viewFrustum)) {
+                cullStats.bonecosCulled++;
+                continue;
+            }
+        }
+        BonecoInstance* instance = &batch->visible[visibleCount++];
+        // Billboard cilíndrico: a cabeça só gira em Y para olhar a câmera
+        float dx = cameraPos[0] - position[0];
+        float dz = cameraPos[2] - (position[2] + bonecoHeadForward);
+        glm_vec3_copy(position, instance->placement);
+        instance->placement[3] = atan2f(dx, dz);
+        instance->headLayer = slots[i].type % BONECO_TYPES;
+        glm_vec3_copy((float*)bonecoTypeColors[instance->headLayer], instance->color);
+        layerCount[instance->headLayer]++;
+    }
+
+    batch->layerStart[0] = 0;
+    for (int t = 0; t < BONECO_TYPES; t++) batch->layerStart[t + 1] = batch->layerStart[t] + layerCount[t];
+    unsigned int cursor[BONECO_TYPES];
+    memcpy(cursor, batch->layerStart, sizeof(cursor));
+    for (unsigned int k = 0; k < visibleCount; k++) {
+        batch->instances[cursor[batch->visible[k].headLayer]++] = batch->visible[k];
+    }
+    batch->count = visibleCount;
+    return visibleCount;
+}
+
+// Instâncias exigem glDrawElementsInstanced + glVertexAttribDivisor (GL 3.3) e as malhas em VBO
+static int bonecoInstancingReady(void) {
+    BonecoBatch* batch = &bonecoBatch;
+    if (!bonecoInstancing || batch->failed) return 0;
+    if (!GLAD_GL_VERSION_3_3 || RenderBackend_Effective() != RENDER_VBO) return 0;
+    if (!batch->program) {
+        static const char* const attributes[] = { "instancePlacement", "instanceColor", NULL };
+        batch->program = linkProgram(bonecoVertexSource, bonecoFragmentSource, attributes, BONECO_ATTRIB_PLACEMENT);
+        if (!batch->program) {
+            fprintf(stderr, "Aviso: shader dos bonecos falhou - desenhando em lote sem instâncias\n");
+            batch->failed = 1;
+            return 0;
+        }
+        batch->uPartMatrix = glGetUniformLocation(batch->program, "partMatrix");
+        batch->uPartNormalMatrix = glGetUniformLocation(batch->program, "partNormalMatrix");
+        batch->uPartOffset = glGetUniformLocation(batch->program, "partOffset");
+        batch->uBillboard = glGetUniformLocation(batch->program, "billboard");
+        batch->uLit = glGetUniformLocation(batch->program, "lit");
+        batch->uTextured = glGetUniformLocation(batch->program, "textured");
+        batch->uTexture = glGetUniformLocation(batch->program, "texture0");
+        glGenBuffers(1, &batch->instanceBuffer);
+    }
+    return 1;
+}
+
+const char* Bonecos_PathName(void) {
+    return bonecoInstancingReady() ? "instanciados" : "em lote";
+}
+
+static void bonecoSetPart(mat4 partMatrix, vec3 partOffset, float billboard, int lit) {
+    BonecoBatch* batch = &bonecoBatch;
+    mat4 normalMatrix;
+    glm_mat4_inv(partMatrix, normalMatrix);
+    glm_mat4_transpose(normalMatrix);
+    glUniformMatrix4fv(batch->uPartMatrix, 1, GL_FALSE, (const GLfloat*)partMatrix);
+    glUniformMatrix4fv(batch->uPartNormalMatrix, 1, GL_FALSE, (const GLfloat*)normalMatrix);
+    glUniform3fv(batch->uPartOffset, 1, (const GLfloat*)partOffset);
+    glUniform1f(batch->uBillboard, billboard);
+    glUniform1i(batch->uLit, lit);
+}
+
+// Aponta os atributos por instância para o trecho do buffer que começa em first
+static void bonecoBindInstances(unsigned int first) {
+    GLsizei stride = sizeof(BonecoInstance);
+    size_t base = (size_t)first * sizeof(BonecoInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, bonecoBatch.instanceBuffer);
+    glVertexAttribPointer(BONECO_ATTRIB_PLACEMENT, 4, GL_FLOAT, GL_FALSE, stride, (const void*)(base + offsetof(BonecoInstance, placement)));
+    glVertexAttribPointer(BONECO_ATTRIB_COLOR, 3, GL_FLOAT, GL_FALSE, stride, (const void*)(base + offsetof(BonecoInstance, color)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Cor por instância (array) ou uma cor só para todas (atributo constante)
+static void bonecoSetColorSource(int perInstance, const float* constantColor) {
+    if (perInstance) {
+        glEnableVertexAttribArray(BONECO_ATTRIB_COLOR);
+    } else {
+        glDisableVertexAttribArray(BONECO_ATTRIB_COLOR);
+        glVertexAttrib3fv(BONECO_ATTRIB_COLOR, constantColor);
+    }
+}
+
+static void bonecoDrawInstanced(int hasTrunkModel, mat4 trunkMatrix, mat4 headMatrix) {
+    BonecoBatch* batch = &bonecoBatch;
+    static const float white[3] = { 1.0f, 1.0f, 1.0f };
+    glBindBuffer(GL_ARRAY_BUFFER, batch->instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(batch->count * sizeof(BonecoInstance)), batch->instances, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glUseProgram(batch->program);
+    glUniform1i(batch->uTexture, 0);
+    glEnableVertexAttribArray(BONECO_ATTRIB_PLACEMENT);
+    glVertexAttribDivisor(BONECO_ATTRIB_PLACEMENT, 1);
+    glVertexAttribDivisor(BONECO_ATTRIB_COLOR, 1);
+    modelBeginArrays(RENDER_VBO);
+
+    // Troncos: uma chamada por malha para todos os bonecos. Como em meshBindMaterial, malha
+    // sem textura usa a própria cor difusa e malha texturizada é modulada pela cor do tipo.
+    bonecoSetPart(trunkMatrix, (vec3){ 0.0f, 0.0f, 0.0f }, 0.0f, hasTrunkModel);
+    bonecoBindInstances(0);
+    unsigned int numParts = hasTrunkModel ? menModel->numMeshes : 1;
+    for (unsigned int p = 0; p < numParts; p++) {
+        Mesh* mesh = hasTrunkModel ? &menModel->meshes[p] : Primitive_Mesh(PRIMITIVE_CUBE);
+        Mesh_PrepareForDraw(mesh);
+        if (!mesh->vertexBuffer) continue;
+        int textured = hasTrunkModel && mesh->numTextures > 0;
+        if (textured) glBindTexture(GL_TEXTURE_2D, mesh->textures[0].id);
+        glUniform1i(batch->uTextured, textured);
+        bonecoSetColorSource(!hasTrunkModel || textured, mesh->diffuseColor);
+        meshDrawBuffers(mesh, batch->count);
+    }
+
+    // Cabeças: uma chamada por textura, cada uma sobre o seu trecho do buffer
+    Mesh* sphere = Primitive_Mesh(PRIMITIVE_SPHERE);
+    Mesh_PrepareForDraw(sphere);
+    bonecoSetPart(headMatrix, (vec3){ 0.0f, bonecoTrunkHeight + bonecoHeadRadius, bonecoHeadForward }, 1.0f, 0);
+    glUniform1i(batch->uTextured, texturesLoaded);
+    bonecoSetColorSource(!texturesLoaded, white);
+    for (int t = 0; t < BONECO_TYPES && sphere->vertexBuffer; t++) {
+        unsigned int layerCount = batch->layerStart[t + 1] - batch->layerStart[t];
+        if (layerCount == 0) continue;
+        if (texturesLoaded) glBindTexture(GL_TEXTURE_2D, headTextures[t]);
+        bonecoBindInstances(batch->layerStart[t]);
+        meshDrawBuffers(sphere, layerCount);
+    }
+
+    modelEndArrays(RENDER_VBO);
+    glVertexAttribDivisor(BONECO_ATTRIB_PLACEMENT, 0);
+    glVertexAttribDivisor(BONECO_ATTRIB_COLOR, 0);
+    glDisableVertexAttribArray(BONECO_ATTRIB_PLACEMENT);
+    glDisableVertexAttribArray(BONECO_ATTRIB_COLOR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+}
+
+// Mesma lista pelo pipeline fixo: material uma vez por malha/textura, matriz por boneco
+static void bonecoDrawBatched(int hasTrunkModel, mat4 trunkMatrix, mat4 headMatrix) {
+    BonecoBatch* batch = &bonecoBatch;
+    RenderBackend backend = RenderBackend_Effective();
+    modelBeginArrays(backend);
+
+    // Troncos (o MEN.obj é iluminado; o cubo reserva não)
+    if (hasTrunkModel) glEnable(GL_LIGHTING);
+    unsigned int numParts = hasTrunkModel ? menModel->numMeshes : 1;
+    for (unsigned int p = 0; p < numParts; p++) {
+        Mesh* mesh = hasTrunkModel ? &menModel->meshes[p] : Primitive_Mesh(PRIMITIVE_CUBE);
+        int perInstanceColor = !hasTrunkModel || mesh->numTextures > 0;
+        if (hasTrunkModel) meshBindMaterial(mesh);
+        for (unsigned int k = 0; k < batch->count; k++) {
+            const BonecoInstance* instance = &batch->instances[k];
+            if (perInstanceColor) glColor3fv((const GLfloat*)instance->color);
+            glPushMatrix();
+            glTranslatef(instance->placement[0], instance->placement[1], instance->placement[2]);
+            glMultMatrixf((const GLfloat*)trunkMatrix);
+            meshDrawGeometry(mesh, backend);
+            glPopMatrix();
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_LIGHTING);
+
+    // Cabeças, agrupadas por textura
+    Mesh* sphere = Primitive_Mesh(PRIMITIVE_SPHERE);
+    if (texturesLoaded) {
+        glEnable(GL_TEXTURE_2D);
+        glColor3f(1.0f, 1.0f, 1.0f);
+    } else {
+        glDisable(GL_TEXTURE_2D);
+    }
+    for (int t = 0; t < BONECO_TYPES; t++) {
+        if (texturesLoaded && batch->layerStart[t + 1] > batch->layerStart[t]) glBindTexture(GL_TEXTURE_2D, headTextures[t]);
+        for (unsigned int k = batch->layerStart[t]; k < batch->layerStart[t + 1]; k++) {
+            const BonecoInstance* instance = &batch->instances[k];
+            if (!texturesLoaded) glColor3fv((const GLfloat*)instance->color);
+            glPushMatrix();
+            glTranslatef(instance->placement[0], instance->placement[1] + bonecoTrunkHeight + bonecoHeadRadius,
+                         instance->placement[2] + bonecoHeadForward);
+            glRotatef(glm_deg(instance->placement[3]), 0.0f, 1.0f, 0.0f);
+            glMultMatrixf((const GLfloat*)headMatrix);
+            meshDrawGeometry(sphere, backend);
+            glPopMatrix();
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    modelEndArrays(backend);
+}
+
+// Desenha os bonecos de slots[first .. first + count): troncos (MEN.obj ou cubo) e cabeças
+void Bonecos_Draw(unsigned int first, unsigned int count) {
+    if (first >= numSlots) return;
+    if (count > numSlots - first) count = numSlots - first;
+    int hasTrunkModel = menModel != NULL && menModel->numMeshes > 0;
+    mat4 trunkMatrix, headMatrix;
+    bonecoTrunkMatrix(hasTrunkModel, trunkMatrix);
+    bonecoHeadMatrix(headMatrix);
+    if (bonecoGather(first, count, hasTrunkModel, trunkMatrix) == 0) return;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    if (bonecoInstancingReady()) bonecoDrawInstanced(hasTrunkModel, trunkMatrix, headMatrix);
+    else bonecoDrawBatched(hasTrunkModel, trunkMatrix, headMatrix);
+    glPopAttrib();
+}
+
+void Bonecos_Shutdown(void) {
+    BonecoBatch* batch = &bonecoBatch;
+    if (batch->instanceBuffer) glDeleteBuffers(1, &batch->instanceBuffer);
+    if (batch->program) glDeleteProgram(batch->program);
+    free(batch->visible);
+    free(batch->instances);
+    memset(batch, 0, sizeof(*batch));
+}
+
+// ---- Cache de estado do GL ----
+// Guarda o que já está ligado (iluminação, textura, depth test, cor) e só chama o GL
+// quando o valor muda. Código que mexe no GL por fora (glPushAttrib/glPopAttrib, HUD,
+// shaders) deixa o cache desatualizado, então quem usa o cache começa com
+// GlState_Invalidate. stateStats conta os pedidos e as chamadas enviadas no quadro.
+
+#define GL_STATE_UNKNOWN_FLAG 2   // nem GL_TRUE nem GL_FALSE
+
+typedef struct {
+    int bypass;                // fila desligada (tecla Q): tudo é enviado, como antes
+    GLboolean lighting, texture2D, depthTest;
+    GLuint texture;
+    vec3 color;
+} GlStateCache;
+
+static GlStateCache glState;
+StateStats stateStats;
+
+// Esquece o estado: valores que nenhum pedido repete, então o próximo de cada um vai para o GL
+void GlState_Invalidate(void) {
+    glState.lighting = glState.texture2D = glState.depthTest = GL_STATE_UNKNOWN_FLAG;
+    glState.texture = ~0u;
+    glm_vec3_fill(glState.color, NAN);
+}
+
+// Conta o pedido e diz se ele precisa ir para o GL
+static int glStateChanged(int same) {
+    stateStats.requested++;
+    if (same && !glState.bypass) return 0;
+    stateStats.issued++;
+    return 1;
+}
+
+static void glStateCapability(GLenum cap, GLboolean* cached, GLboolean on) {
+    if (!glStateChanged(*cached == on)) return;
+    if (on) glEnable(cap);
+    else glDisable(cap);
+    *cached = on;
+}
+
+void GlState_Lighting(GLboolean on) { glStateCapability(GL_LIGHTING, &glState.lighting, on); }
+void GlState_Texture2D(GLboolean on) { glStateCapability(GL_TEXTURE_2D, &glState.texture2D, on); }
+void GlState_DepthTest(GLboolean on) { glStateCapability(GL_DEPTH_TEST, &glState.depthTest, on); }
+
+void GlState_BindTexture(GLuint texture) {
+    if (!glStateChanged(glState.texture == texture)) return;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glState.texture = texture;
+}
+
+void GlState_Color3fv(const float* color) {
+    if (!glStateChanged(memcmp(glState.color, color, sizeof(vec3)) == 0)) return;
+    glColor3fv((const GLfloat*)color);
+    glm_vec3_copy((float*)color, glState.color);
+}
+
+// ---- Fila de desenho ----
+// A sala e o martelo não são desenhados na hora: cada malha vira um RenderItem com uma
+// chave de 64 bits [passada | iluminação | textura? | material | profundidade | ordem]
+// e a fila é ordenada e executada pelo cache de estado. Na passada opaca itens de mesmo
+// material (textura, ou a cor difusa) ficam juntos e, dentro dele, da frente para trás
+// (o depth test descarta mais cedo). Na sobreposta (martelo, sem depth test) a ordem
+// de envio é mantida. Com a fila desligada (tecla Q) os itens saem na ordem de envio
+// e todo o estado é reenviado, para comparar as contagens no HUD.
+
+#define RENDER_KEY_PASS_SHIFT 62
+#define RENDER_KEY_LIT_SHIFT 61
+#define RENDER_KEY_TEXTURED_SHIFT 60
+#define RENDER_KEY_MATERIAL_SHIFT 36     // 24 bits: id da textura ou cor RGB8
+#define RENDER_KEY_DEPTH_SHIFT 20        // 16 bits: distância no eixo da câmera
+#define RENDER_KEY_SEQUENCE_MASK 0xFFFFFu
+#define RENDER_QUEUE_FAR 1000.0f
+
+typedef struct {
+    uint64_t key;
+    Mesh* mesh;
+    mat4 modelView;
+    GLuint texture;            // 0 = cor sólida (color)
+    vec3 color;
+    GLboolean lit;
+    RenderPass pass;
+} RenderItem;
+
+typedef struct {
+    RenderItem* items;
+    unsigned int count, capacity;
+    int sorted;
+} RenderQueue;
+
+int renderQueueEnabled = 1; // tecla Q alterna
+static RenderQueue renderQueue;
+
+static uint64_t renderItemKey(RenderItem* item, unsigned int sequence) {
+    uint64_t key = (uint64_t)item->pass << RENDER_KEY_PASS_SHIFT;
+    key |= (uint64_t)(sequence & RENDER_KEY_SEQUENCE_MASK);
+    if (!renderQueueEnabled || item->pass == RENDER_PASS_OVERLAY) return key;
+
+    uint32_t material;
+    if (item->texture) {
+        material = item->texture & 0xFFFFFFu;
+    } else {
+        material = ((uint32_t)(glm_clamp(item->color[0], 0.0f, 1.0f) * 255.0f) << 16)
+                 | ((uint32_t)(glm_clamp(item->color[1], 0.0f, 1.0f) * 255.0f) << 8)
+                 | (uint32_t)(glm_clamp(item->color[2], 0.0f, 1.0f) * 255.0f);
+    }
+    // Profundidade do centro da esfera envolvente (espaço da câmera olha para -Z)
+    vec3 center;
+    glm_mat4_mulv3(item->modelView, item->mesh->boundingSphere, 1.0f, center);
+    float depth = glm_clamp(-center[2] / RENDER_QUEUE_FAR, 0.0f, 1.0f);
+
+    key |= (uint64_t)(item->lit ? 1 : 0) << RENDER_KEY_LIT_SHIFT;
+    key |= (uint64_t)(item->texture ? 1 : 0) << RENDER_KEY_TEXTURED_SHIFT;
+    key |= (uint64_t)material << RENDER_KEY_MATERIAL_SHIFT;
+    key |= (uint64_t)(depth * 65535.0f) << RENDER_KEY_DEPTH_SHIFT;
+    return key;
+}
+
+// Zera a fila e os contadores de estado do quadro
+void RenderQueue_BeginFrame(void) {
+    renderQueue.count = 0;
+    renderQueue.sorted = 0;
+    memset(&stateStats, 0, sizeof(stateStats));
+}
+
+// Enfileira uma malha com a matriz modelview completa (view * modelo). Malha texturizada
+// não mexe na cor (como meshBindMaterial); sem textura, usa color.
+void RenderQueue_Submit(RenderPass pass, Mesh* mesh, mat4 modelView, GLuint texture, const float* color, GLboolean lit) {
+    RenderQueue* queue = &renderQueue;
+    if (queue->count == queue->capacity) {
+        unsigned int capacity = queue->capacity ? queue->capacity * 2 : 128;
+        RenderItem* items = (RenderItem*)realloc(queue->items, capacity * sizeof(RenderItem));
+        if (!items) return;
+        queue->items = items;
+        queue->capacity = capacity;
+    }
+    RenderItem* item = &queue->items[queue->count];
+    item->mesh = mesh;
+    glm_mat4_copy(modelView, item->modelView);
+    item->texture = texture;
+    if (color) glm_vec3_copy((float*)color, item->color);
+    else glm_vec3_one(item->color);
+    item->lit = lit;
+    item->pass = pass;
+    item->key = renderItemKey(item, queue->count);
+    queue->count++;
+    queue->sorted = 0;
+}
+
+static int renderItemCompare(const void* a, const void* b) {
+    uint64_t ka = ((const RenderItem*)a)->key, kb = ((const RenderItem*)b)->key;
+    return ka < kb ? -1 : (ka > kb ? 1 : 0);
+}
+
+// Desenha os itens da passada. O estado deixado no fim é o de antes da fila (luz ligada,
+// sem textura, depth test ligado), que é o que o resto de renderScene espera.
+void RenderQueue_Execute(RenderPass pass) {
+    RenderQueue* queue = &renderQueue;
+    if (!queue->sorted) {
+        qsort(queue->items, queue->count, sizeof(RenderItem), renderItemCompare);
+        queue->sorted = 1;
+    }
+    glState.bypass = !renderQueueEnabled;
+    GlState_Invalidate();
+
+    RenderBackend backend = RenderBackend_Effective();
+    const float* loadedMatrix = NULL;
+    int drew = 0;
+    for (unsigned int i = 0; i < queue->count; i++) {
+        const RenderItem* item = &queue->items[i];
+        if (item->pass != pass) continue;
+        if (!drew) {
+            modelBeginArrays(backend);
+            glPushMatrix();
+            drew = 1;
+        }
+        GlState_DepthTest(pass != RENDER_PASS_OVERLAY);
+        GlState_Lighting(item->lit);
+        GlState_Texture2D(item->texture != 0);
+        if (item->texture) GlState_BindTexture(item->texture);
+        else GlState_Color3fv(item->color);
+        if (!loadedMatrix || memcmp(loadedMatrix, item->modelView, sizeof(mat4)) != 0) {
+            glLoadMatrixf((const GLfloat*)item->modelView);
+            loadedMatrix = (const float*)item->modelView;
+        }
+        meshDrawGeometry(item->mesh, backend);
+    }
+    if (!drew) return;
+    glPopMatrix();
+    modelEndArrays(backend);
+
+    GlState_BindTexture(0);
+    GlState_Texture2D(GL_FALSE);
+    GlState_Lighting(GL_TRUE);
+    GlState_DepthTest(GL_TRUE);
+}
+
+void RenderQueue_Shutdown(void) {
+    free(renderQueue.items);
+    memset(&renderQueue, 0, sizeof(renderQueue));
+}
+
+// ---- Texto em atlas de glifos ----
+// As duas fontes bitmap do GLUT usadas no jogo são rasterizadas uma vez em uma textura
+// (FBO, GL 3.0): cada glifo é desenhado com glutBitmapCharacter em uma célula, a imagem
+// é lida de volta e a caixa com tinta de cada célula vira o retângulo do glifo. Uma
+// string vira quads alinhados aos pixels que repetem exatamente o glBitmap. Text_Draw só
+// enfileira; a disposição de cada (fonte, string) fica em cache e é refeita só quando o
+// texto muda, e Text_Flush desenha tudo o que foi enfileirado em uma chamada. Sem GL 3.0
+// Text_Draw desenha na hora com glutBitmapCharacter, como antes.
+
+#define TEXT_FIRST_CHAR 32
+#define TEXT_CHAR_COUNT 224          // bytes 32..255 (as fontes do GLUT são Latin-1)
+#define TEXT_ATLAS_COLUMNS 16
+#define TEXT_CELL_PAD 4              // folga para a origem do bitmap fora da caneta
+#define TEXT_LAYOUT_CACHE 64
+
+typedef struct {
+    float x0, y0, x1, y1;            // em relação à caneta (pixels)
+    float u0, v0, u1, v1;
+    int advance;
+    int hasInk;                      // espaço: só avança
+} TextGlyph;
+
+// Quads de uma string em relação à origem, 8 floats por glifo (como em TextGlyph)
+typedef struct {
+    uint32_t hash;
+    TextFont font;
+    char* text;
+    float* quads;
+    int numQuads, capacity;
+    unsigned int lastUsed;
+} TextLayout;
+
+typedef struct {
+    GLfloat x, y, u, v;
+    GLubyte color[4];
+} TextVertex;
+
+typedef struct {
+    GLuint texture;
+    int ready, failed;
+    TextGlyph glyphs[TEXT_FONT_COUNT][TEXT_CHAR_COUNT];
+    TextLayout layouts[TEXT_LAYOUT_CACHE];
+    unsigned int useCounter;
+    TextVertex* vertices;
+    int numVertices, capacity;
+} TextRenderer;
+
+static TextRenderer text;
+
+static void* textGlutFont(TextFont font) {
+    return font == TEXT_FONT_LARGE ? GLUT_BITMAP_HELVETICA_18 : GLUT_BITMAP_HELVETICA_12;
+}
+
+// Rasteriza as fontes no atlas. Chamada uma vez, com a janela já criada.
+void Text_Init(void) {
+    if (text.ready || text.failed) return;
+    if (!GLAD_GL_VERSION_3_0 || headlessFrames) {
+        text.failed = 1;
+        return;
+    }
+    double start = glutGet(GLUT_ELAPSED_TIME);
+
+    // Uma faixa de células por fonte, uma em cima da outra
+    int cellWidth[TEXT_FONT_COUNT], cellHeight[TEXT_FONT_COUNT], baseY[TEXT_FONT_COUNT];
+    int rows = (TEXT_CHAR_COUNT + TEXT_ATLAS_COLUMNS - 1) / TEXT_ATLAS_COLUMNS;
+    int atlasWidth = 0, atlasHeight = 0;
+    for (int f = 0; f < TEXT_FONT_COUNT; f++) {
+        int maxAdvance = 0;
+        for (int c = 0; c < TEXT_CHAR_COUNT; c++) {
+            int advance = glutBitmapWidth(textGlutFont((TextFont)f), TEXT_FIRST_CHAR + c);
+            if (advance > maxAdvance) maxAdvance = advance;
+        }
+        // A altura da linha cobre ascendentes e descendentes; a linha de base fica no meio
+        cellWidth[f] = maxAdvance + 2 * TEXT_CELL_PAD;
+        cellHeight[f] = 2 * glutBitmapHeight(textGlutFont((TextFont)f));
+        baseY[f] = atlasHeight;
+        if (cellWidth[f] * TEXT_ATLAS_COLUMNS > atlasWidth) atlasWidth = cellWidth[f] * TEXT_ATLAS_COLUMNS;
+        atlasHeight += cellHeight[f] * rows;
+    }
+
+    GLuint colorBuffer, framebuffer;
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, atlasWidth, atlasHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Aviso: FBO do atlas de texto incompleto; usando glutBitmapCharacter\n");
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        text.failed = 1;
+        return;
+    }
+
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    glViewport(0, 0, atlasWidth, atlasHeight);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_DEPTH_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    gluOrtho2D(0, atlasWidth, 0, atlasHeight);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    for (int f = 0; f < TEXT_FONT_COUNT; f++) {
+        for (int c = 0; c < TEXT_CHAR_COUNT; c++) {
+            int cellX = (c % TEXT_ATLAS_COLUMNS) * cellWidth[f];
+            int cellY = baseY[f] + (c / TEXT_ATLAS_COLUMNS) * cellHeight[f];
+            glRasterPos2i(cellX + TEXT_CELL_PAD, cellY + cellHeight[f] / 2);
+            glutBitmapCharacter(textGlutFont((TextFont)f), TEXT_FIRST_CHAR + c);
+        }
+    }
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+
+    unsigned char* alpha = (unsigned char*)malloc((size_t)atlasWidth * atlasHeight);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, atlasWidth, atlasHeight, GL_ALPHA, GL_UNSIGNED_BYTE, alpha);
+    glPopAttrib();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+
+    // Caixa com tinta de cada célula, relativa à posição da caneta usada acima
+    for (int f = 0; f < TEXT_FONT_COUNT; f++) {
+        for (int c = 0; c < TEXT_CHAR_COUNT; c++) {
+            TextGlyph* glyph = &text.glyphs[f][c];
+            int cellX = (c % TEXT_ATLAS_COLUMNS) * cellWidth[f];
+            int cellY = baseY[f] + (c / TEXT_ATLAS_COLUMNS) * cellHeight[f];
+            int penX = cellX + TEXT_CELL_PAD, penY = cellY + cellHeight[f] / 2;
+            int minX = cellX + cellWidth[f], minY = cellY + cellHeight[f], maxX = -1, maxY = -1;
+            for (int y = cellY; y < cellY + cellHeight[f]; y++) {
+                for (int x = cellX; x < cellX + cellWidth[f]; x++) {
+                    if (alpha[(size_t)y * atlasWidth + x] < 128) continue;
+                    if (x < minX) minX = x;
+                    if (x > maxX) maxX = x;
+                    if (y < minY) minY = y;
+                    if (y > maxY) maxY = y;
+                }
+            }
+            glyph->advance = glutBitmapWidth(textGlutFont((TextFont)f), TEXT_FIRST_CHAR + c);
+            glyph->hasInk = maxX >= 0;
+            if (!glyph->hasInk) continue;
+            glyph->x0 = (float)(minX - penX);
+            glyph->y0 = (float)(minY - penY);
+            glyph->x1 = (float)(maxX + 1 - penX);
+            glyph->y1 = (float)(maxY + 1 - penY);
+            glyph->u0 = (float)minX / atlasWidth;
+            glyph->v0 = (float)minY / atlasHeight;
+            glyph->u1 = (float)(maxX + 1) / atlasWidth;
+            glyph->v1 = (float)(maxY + 1) / atlasHeight;
+        }
+    }
+
+    glGenTextures(1, &text.texture);
+    glBindTexture(GL_TEXTURE_2D, text.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA8, atlasWidth, atlasHeight, 0, GL_ALPHA, GL_UNSIGNED_BYTE, alpha);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    free(alpha);
+
+    text.ready = 1;
+    printf("Atlas de texto: %dx%d, %d glifos em %.0f ms\n", atlasWidth, atlasHeight,
+           TEXT_FONT_COUNT * TEXT_CHAR_COUNT, glutGet(GLUT_ELAPSED_TIME) - start);
+}
+
+// Próximo caractere da string em Latin-1 (as fontes do GLUT): o código-fonte é UTF-8, então
+// sequências de dois bytes até U+00FF viram um caractere; o resto é pulado (-1).
+// Passar os bytes direto para glutBitmapCharacter descartava "ç", "ã", "á"...
+static int textNextChar(const unsigned char** cursor) {
+    const unsigned char* c = *cursor;
+    if (c[0] < 0x80) {
+        *cursor = c + 1;
+        return c[0] >= TEXT_FIRST_CHAR ? c[0] : -1;
+    }
+    if ((c[0] == 0xC2 || c[0] == 0xC3) && (c[1] & 0xC0) == 0x80) {
+        *cursor = c + 2;
+        int code = ((c[0] & 0x1F) << 6) | (c[1] & 0x3F);
+        return code >= 0xA0 ? code : -1;
+    }
+    // Outros bytes iniciais e de continuação
+    *cursor = c + 1;
+    while ((**cursor & 0xC0) == 0x80) (*cursor)++;
+    return -1;
+}
+
+static uint32_t textHash(TextFont font, const char* str) {
+    uint32_t hash = 2166136261u ^ (uint32_t)font;
+    for (const unsigned char* c = (const unsigned char*)str; *c; c++) {
+        hash ^= *c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Layout em cache da string; refeito só quando (fonte, texto) não está na tabela.
+// Na falta, ocupa a entrada usada há mais tempo.
+static TextLayout* textLayout(TextFont font, const char* str) {
+    uint32_t hash = textHash(font, str);
+    TextLayout* oldest = &text.layouts[0];
+    for (int i = 0; i < TEXT_LAYOUT_CACHE; i++) {
+        TextLayout* layout = &text.layouts[i];
+        if (layout->text && layout->hash == hash && layout->font == font && strcmp(layout->text, str) == 0) {
+            layout->lastUsed = ++text.useCounter;
+            return layout;
+        }
+        if (layout->lastUsed < oldest->lastUsed) oldest = layout;
+    }
+
+    TextLayout* layout = oldest;
+    size_t length = strlen(str);
+    char* copy = (char*)realloc(layout->text, length + 1);
+    if (!copy) return NULL;
+    memcpy(copy, str, length + 1);
+    layout->text = copy;
+    if ((int)length > layout->capacity) {
+        float* quads = (float*)realloc(layout->quads, length * 8 * sizeof(float));
+        if (!quads) {
+            free(layout->text);
+            layout->text = NULL;
+            return NULL;
+        }
+        layout->quads = quads;
+        layout->capacity = (int)length;
+    }
+    layout->hash = hash;
+    layout->font = font;
+    layout->numQuads = 0;
+    layout->lastUsed = ++text.useCounter;
+
+    int penX = 0;
+    const unsigned char* cursor = (const unsigned char*)str;
+    while (*cursor) {
+        int ch = textNextChar(&cursor);
+        if (ch < 0) continue;
+        const TextGlyph* glyph = &text.glyphs[font][ch - TEXT_FIRST_CHAR];
+        if (glyph->hasInk) {
+            float* quad = &layout->quads[layout->numQuads * 8];
+            quad[0] = penX + glyph->x0; quad[1] = glyph->y0;
+            quad[2] = penX + glyph->x1; quad[3] = glyph->y1;
+            quad[4] = glyph->u0; quad[5] = glyph->v0;
+            quad[6] = glyph->u1; quad[7] = glyph->v1;
+            layout->numQuads++;
+        }
+        penX += glyph->advance;
+    }
+    return layout;
+}
+
+// Enfileira a string com a linha de base em (x, y), como glRasterPos2i + glutBitmapCharacter
+void Text_Draw(TextFont font, int x, int y, const float* color, const char* str) {
+    if (!text.ready) {
+        if (headlessFrames) return; // sem glutInit não há fontes do GLUT
+        glColor3fv(color);
+        glRasterPos2i(x, y);
+        const unsigned char* cursor = (const unsigned char*)str;
+        while (*cursor) {
+            int ch = textNextChar(&cursor);
+            if (ch >= 0) glutBitmapCharacter(textGlutFont(font), ch);
+        }
+        return;
+    }
+    TextLayout* layout = textLayout(font, str);
+    if (!layout || layout->numQuads == 0) return;
+
+    int needed = text.numVertices + layout->numQuads * 4;
+    if (needed > text.capacity) {
+        int capacity = text.capacity ? text.capacity : 1024;
+        while (capacity < needed) capacity *= 2;
+        TextVertex* vertices = (TextVertex*)realloc(text.vertices, capacity * sizeof(TextVertex));
+        if (!vertices) return;
+        text.vertices = vertices;
+        text.capacity = capacity;
+    }
+
+    GLubyte rgba[4] = { (GLubyte)(glm_clamp(color[0], 0.0f, 1.0f) * 255.0f + 0.5f),
+                        (GLubyte)(glm_clamp(color[1], 0.0f, 1.0f) * 255.0f + 0.5f),
+                        (GLubyte)(glm_clamp(color[2], 0.0f, 1.0f) * 255.0f + 0.5f), 255 };
+    TextVertex* v = &text.vertices[text.numVertices];
+    for (int i = 0; i < layout->numQuads; i++) {
+        const float* quad = &layout->quads[i * 8];
+        float corners[4][4] = {
+            { quad[0], quad[1], quad[4], quad[5] },
+            { quad[2], quad[1], quad[6], quad[5] },
+            { quad[2], quad[3], quad[6], quad[7] },
+            { quad[0], quad[3], quad[4], quad[7] },
+        };
+        for (int k = 0; k < 4; k++, v++) {
+            v->x = x + corners[k][0];
+            v->y = y + corners[k][1];
+            v->u = corners[k][2];
+            v->v = corners[k][3];
+            memcpy(v->color, rgba, sizeof(rgba));
+        }
+    }
+    text.numVertices = needed;
+}
+
+// Desenha o texto enfileirado em uma chamada. Chamada com a projeção de tela já montada;
+// depth test e blend ficam como quem chama deixou (os glifos são opacos).
+void Text_Flush(void) {
+    if (!text.ready || text.numVertices == 0) return;
+    glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT);
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glDisable(GL_LIGHTING);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, text.texture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glEnable(GL_ALPHA_TEST);
+    glAlphaFunc(GL_GREATER, 0.5f);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(TextVertex), &text.vertices[0].x);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(TextVertex), &text.vertices[0].u);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(TextVertex), text.vertices[0].color);
+    glDrawArrays(GL_QUADS, 0, text.numVertices);
+
+    glPopClientAttrib();
+    glPopAttrib();
+    text.numVertices = 0;
+}
+
+void Text_Shutdown(void) {
+    if (text.texture) glDeleteTextures(1, &text.texture);
+    for (int i = 0; i < TEXT_LAYOUT_CACHE; i++) {
+        free(text.layouts[i].text);
+        free(text.layouts[i].quads);
+    }
+    free(text.vertices);
+    memset(&text, 0, sizeof(text));
+}
+
+// ---- Painéis 2D em textura ----
+// Placar, menu, lista de pontuações e modal final só mudam com entrada do jogador ou na
+// virada do segundo do timer. Cada painel é desenhado em uma textura própria (FBO,
+// GL 3.0) quando as entradas passadas a Overlay_Draw mudam; nos outros quadros ele é só
+// um quad texturizado. A textura guarda a cor já multiplicada pelo alfa, então o quad
+// com glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA) dá o mesmo resultado que desenhar o
+// painel direto por cima da cena. Sem GL 3.0 os painéis são desenhados a cada quadro.
+
+#define OVERLAY_MAX_INPUTS 4
+
+// Desenha o painel com a origem no canto inferior esquerdo; inputs como em Overlay_Draw
+typedef void (*OverlayPaint)(int width, int height, const int* inputs);
+
+typedef struct {
+    int width, height;
+    int centered;                  // 0: encostado no canto superior esquerdo
+    OverlayPaint paint;
+} OverlayPanelInfo;
+
+typedef struct {
+    GLuint framebuffer, texture;
+    int inputs[OVERLAY_MAX_INPUTS];
+    int numInputs;
+    int valid;
+    unsigned int rebuilds;
+} OverlayPanelCache;
+
+static struct {
+    OverlayPanelCache panels[OVERLAY_COUNT];
+    int failed;
+} overlay;
+
+static void overlayQuad(int x0, int y0, int x1, int y1) {
+    glBegin(GL_QUADS);
+        glVertex2i(x0, y0);
+        glVertex2i(x1, y0);
+        glVertex2i(x1, y1);
+        glVertex2i(x0, y1);
+    glEnd();
+}
+
+// inputs: score, segundos restantes (-1 sem partida), pausado
+static void paintScoreboard(int width, int height, const int* inputs) {
+    (void)width;
+    char scoreStr[64];
+    sprintf(scoreStr, "Score: %d", inputs[0]);
+    Text_Draw(TEXT_FONT_LARGE, 10, height - 20, (const float[3]){ 1.0f, 1.0f, 1.0f }, scoreStr);
+    if (inputs[1] >= 0) {
+        char timeStr[64];
+        sprintf(timeStr, "Tempo: %02d:%02d%s", inputs[1] / 60, inputs[1] % 60, inputs[2] ? " (PAUSADO)" : "");
+        Text_Draw(TEXT_FONT_LARGE, 10, height - 40, (const float[3]){ 1.0f, 1.0f, 0.2f }, timeStr);
+    }
+    Text_Flush();
+}
+
+// inputs: opção selecionada, índice da duração, modo visual, ordenação
+static void paintMenu(int boxW, int boxH, const int* inputs) {
+    int topOffset = 80;
+    int optSpacing = 50;
+
+    // Fundo semi-transparente
+    glColor4f(0.05f, 0.05f, 0.05f, 0.9f);
+    overlayQuad(0, 0, boxW, boxH);
+
+    // Opções do menu
+    const char* options[] = { "Iniciar Jogo", "Duração: ", "Modo Visual: ", "Ordenar por: ", "Pontuacoes", "Sair" };
+    static const float optionColor[3] = { 1.0f, 1.0f, 1.0f };
+    static const float selectedColor[3] = { 1.0f, 0.95f, 0.3f };
+    char line[128];
+    // Desenha opção destacada com retângulo e depois o texto
+    for (int i = 0; i < menuOptionCount; i++) {
+        int y = boxH - topOffset - i * optSpacing;
+        if (i == 1) sprintf(line, "%s%d s", options[i], menuDurations[inputs[1]]);
+        else if (i == 2) sprintf(line, "%s%s", options[i], inputs[2] ? "Bonecos 3D" : "Quadrados verdes");
+        else if (i == 3) sprintf(line, "%s%s", options[i], inputs[3] ? "Melhores" : "Mais recentes");
+        else sprintf(line, "%s", options[i]);
+
+        const float* textColor = optionColor;
+        if (i == inputs[0]) {
+            glColor4f(0.22f, 0.18f, 0.06f, 0.95f);
+            overlayQuad(20, y - 12, boxW - 60, y + 30);
+            textColor = selectedColor;
+        }
+        Text_Draw(TEXT_FONT_LARGE, 40, y + 8, textColor, line);
+    }
+    Text_Flush();
+}
+
+// inputs: página, ordenação, versão do histórico
+static void paintScores(int mw, int mh, const int* inputs) {
+    // Ordenação/paginação: só roda quando alguma entrada muda
+    int total = matchHistoryCount;
+    int indices[MATCH_HISTORY_MAX];
+    for (int i = 0; i < total; i++) indices[i] = i;
+    if (inputs[1] && total > 1) {
+        for (int a = 0; a < total-1; a++) for (int b = 0; b < total-1-a; b++) {
+            if (matchHistory[indices[b]].score < matchHistory[indices[b+1]].score) {
+                int t = indices[b]; indices[b] = indices[b+1]; indices[b+1] = t;
+            }
+        }
+    } else {
+        for (int i = 0; i < total/2; i++) {
+            int t = indices[i]; indices[i] = indices[total-1-i]; indices[total-1-i] = t;
+        }
+    }
+    int pages = scoresPageCount();
+    int start = inputs[0] * recordsPerPage;
+    int show = ((total - start) < recordsPerPage) ? (total - start) : recordsPerPage;
+
+    // Fundo do modal
+    glColor4f(0.04f, 0.04f, 0.04f, 0.95f);
+    overlayQuad(0, 0, mw, mh);
+
+    Text_Draw(TEXT_FONT_LARGE, 24, mh-40, (const float[3]){ 1.0f, 0.95f, 0.3f }, "Pontuações");
+
+    // Lista de pontuações
+    static const float listColor[3] = { 0.95f, 0.95f, 0.95f };
+    int listStartY = mh - 80;
+    for (int i = 0; i < show; i++) {
+        int idx = indices[start + i];
+        char buf[128];
+        snprintf(buf, sizeof(buf), "%s - Score: %d", matchHistory[idx].timeStr, matchHistory[idx].score);
+        Text_Draw(TEXT_FONT_SMALL, 32, listStartY - i * 28, listColor, buf);
+    }
+
+    // Paginação e instrução de fechamento
+    char pageStr[64]; snprintf(pageStr, sizeof(pageStr), "Página %d/%d", inputs[0]+1, pages);
+    Text_Draw(TEXT_FONT_SMALL, mw - 140, 28, listColor, pageStr);
+    Text_Draw(TEXT_FONT_SMALL, 24, 28, listColor, "Enter/Esc/M para fechar | <-/-> para navegar | T/t para pág.");
+    Text_Flush();
+}
+
+// inputs: score final
+static void paintFinal(int w, int h, const int* inputs) {
+    glColor4f(0.05f, 0.05f, 0.05f, 0.95f);
+    overlayQuad(0, 0, w, h);
+
+    char body[128]; snprintf(body, sizeof(body), "Score final: %d", inputs[0]);
+    static const float modalColor[3] = { 1.0f, 1.0f, 1.0f };
+    Text_Draw(TEXT_FONT_LARGE, 24, h-48, modalColor, "Partida finalizada!");
+    Text_Draw(TEXT_FONT_LARGE, 24, h-88, modalColor, body);
+    Text_Draw(TEXT_FONT_SMALL, 24, 24, modalColor, "Pressione Enter para voltar ao menu");
+    Text_Flush();
+}
+
+static const OverlayPanelInfo overlayPanels[OVERLAY_COUNT] = {
+    [OVERLAY_SCOREBOARD] = { 320, 48, 0, paintScoreboard },
+    [OVERLAY_MENU] = { 640, 420, 1, paintMenu },
+    [OVERLAY_SCORES] = { 520, 360, 1, paintScores },
+    [OVERLAY_FINAL] = { 420, 220, 1, paintFinal },
+};
+
+// Número de páginas da lista de pontuações (pelo menos uma)
+int scoresPageCount(void) {
+    int pages = (matchHistoryCount + recordsPerPage - 1) / recordsPerPage;
+    return pages > 0 ? pages : 1;
+}
+
+// Estado dos painéis: sem luz, textura nem depth test, com blend
+static void overlayBeginPaint(void) {
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+}
+
+static int overlayCreateTarget(OverlayPanelCache* cache, const OverlayPanelInfo* info) {
+    glGenTextures(1, &cache->texture);
+    glBindTexture(GL_TEXTURE_2D, cache->texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, info->width, info->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &cache->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, cache->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, cache->texture, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Aviso: FBO dos painéis incompleto (0x%x); desenhando direto\n", status);
+        return 0;
+    }
+    return 1;
+}
+
+// Redesenha o painel na textura. O blend separado deixa no alfa a cobertura acumulada
+// (cor pré-multiplicada), que é o que a composição em Overlay_Draw espera.
+static void overlayRebuild(OverlayPanelCache* cache, const OverlayPanelInfo* info, const int* inputs) {
+    glBindFramebuffer(GL_FRAMEBUFFER, cache->framebuffer);
+    glPushAttrib(GL_VIEWPORT_BIT | GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT);
+    glViewport(0, 0, info->width, info->height);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    gluOrtho2D(0, info->width, 0, info->height);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    overlayBeginPaint();
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    info->paint(info->width, info->height, inputs);
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    cache->rebuilds++;
+}
+
+// Desenha o painel por cima da cena; chamada com a projeção de tela montada e sem texto
+// pendente em Text_Draw (o painel usa o mesmo lote). O painel só é redesenhado quando
+// inputs difere da última vez.
+void Overlay_Draw(OverlayPanel panel, const int* inputs, int numInputs) {
+    const OverlayPanelInfo* info = &overlayPanels[panel];
+    OverlayPanelCache* cache = &overlay.panels[panel];
+    int x = info->centered ? (screen_width - info->width) / 2 : 0;
+    int y = info->centered ? (screen_height - info->height) / 2 : screen_height - info->height;
+
+    if (!overlay.failed && !cache->framebuffer) {
+        if (!GLAD_GL_VERSION_3_0 || !overlayCreateTarget(cache, info)) overlay.failed = 1;
+    }
+    if (overlay.failed) {
+        glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT);
+        glPushMatrix();
+        glTranslatef((float)x, (float)y, 0.0f);
+        overlayBeginPaint();
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        info->paint(info->width, info->height, inputs);
+        glPopMatrix();
+        glPopAttrib();
+        return;
+    }
+
+    if (!cache->valid || cache->numInputs != numInputs || memcmp(cache->inputs, inputs, numInputs * sizeof(int)) != 0) {
+        memcpy(cache->inputs, inputs, numInputs * sizeof(int));
+        cache->numInputs = numInputs;
+        cache->valid = 1;
+        overlayRebuild(cache, info, inputs);
+    }
+
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT);
+    overlayBeginPaint();
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, cache->texture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glBegin(GL_QUADS);
+        glTexCoord2f(0.0f, 0.0f); glVertex2i(x, y);
+        glTexCoord2f(1.0f, 0.0f); glVertex2i(x + info->width, y);
+        glTexCoord2f(1.0f, 1.0f); glVertex2i(x + info->width, y + info->height);
+        glTexCoord2f(0.0f, 1.0f); glVertex2i(x, y + info->height);
+    glEnd();
+    glPopAttrib();
+}
+
+void Overlay_Shutdown(void) {
+    for (int i = 0; i < OVERLAY_COUNT; i++) {
+        OverlayPanelCache* cache = &overlay.panels[i];
+        if (cache->framebuffer) glDeleteFramebuffers(1, &cache->framebuffer);
+        if (cache->texture) glDeleteTextures(1, &cache->texture);
+    }
+    memset(&overlay, 0, sizeof(overlay));
+}
+
+// ---- Agendamento de quadros ----
+// Nada chama glutPostRedisplay direto: entrada, timers do jogo e o próprio renderScene
+// pedem quadros por Frame_RequestRedraw/Frame_RequestRedrawIn, que agendam um timer do
+// GLUT no instante certo. O laço do GLUT dorme até lá, então parado no menu o processo
+// não gasta CPU. Modos (tecla F, --frame-mode):
+//   sob demanda: só desenha quando algo mudou, no máximo frameRateCap quadros por segundo
+//   limitado:    desenha sempre, espaçando os quadros em 1/frameRateCap
+//   livre:       desenha sempre, sem esperar (para medir)
+
+FrameMode frameMode = FRAME_ON_DEMAND;
+int frameRateCap = 60; // --fps-cap
+
+static struct {
+    double frameStartMs;     // início do quadro atual (ou do último)
+    double wakeAtMs;         // quadro já agendado (0 = nenhum)
+    unsigned int windowFrames;
+    double windowStartMs;
+    float rate;              // quadros por segundo medidos
+} frameScheduler;
+
+static double frameNowMs(void) {
+    return Clock_NowNs() / 1e6;
+}
+
+const char* Frame_ModeName(FrameMode mode) {
+    switch (mode) {
+        case FRAME_ON_DEMAND: return "sob demanda";
+        case FRAME_CAPPED: return "limitado";
+        case FRAME_UNCAPPED: return "livre";
+        default: return "?";
+    }
+}
+
+int Frame_ParseMode(const char* name, FrameMode* out) {
+    if (strcmp(name, "on-demand") == 0) *out = FRAME_ON_DEMAND;
+    else if (strcmp(name, "capped") == 0) *out = FRAME_CAPPED;
+    else if (strcmp(name, "uncapped") == 0) *out = FRAME_UNCAPPED;
+    else return 0;
+    return 1;
+}
+
+float Frame_Rate(void) {
+    return frameScheduler.rate;
+}
+
+// Timers antigos (de um pedido que foi antecipado ou já atendido) chegam aqui e são ignorados
+static void frameTimer(int value) {
+    (void)value;
+    if (frameScheduler.wakeAtMs == 0.0 || frameNowMs() + 1.0 < frameScheduler.wakeAtMs) return;
+    frameScheduler.wakeAtMs = 0.0;
+    glutPostRedisplay();
+}
+
+// Agenda um quadro para atMs, nunca antes do intervalo mínimo desde o último
+static void frameScheduleAt(double atMs) {
+    if (headlessFrames) return; // sem laço do GLUT: o benchmark chama renderScene direto
+    if (frameMode == FRAME_UNCAPPED) {
+        glutPostRedisplay();
+        return;
+    }
+    double earliest = frameScheduler.frameStartMs + 1000.0 / frameRateCap;
+    if (atMs < earliest) atMs = earliest;
+    if (frameScheduler.wakeAtMs != 0.0 && frameScheduler.wakeAtMs <= atMs) return; // já vem um antes
+    frameScheduler.wakeAtMs = atMs;
+    double delay = atMs - frameNowMs();
+    glutTimerFunc(delay > 0.0 ? (unsigned int)ceil(delay) : 0, frameTimer, 0);
+}
+
+// Pede um quadro assim que o limite de quadros permitir
+void Frame_RequestRedraw(void) {
+    frameScheduleAt(0.0);
+}
+
+// Pede um quadro daqui a ms milissegundos (virada do segundo do timer, por exemplo)
+void Frame_RequestRedrawIn(unsigned int ms) {
+    frameScheduleAt(frameNowMs() + ms);
+}
+
+// Início de renderScene: o quadro atende qualquer pedido pendente
+void Frame_Begin(void) {
+    frameScheduler.frameStartMs = frameNowMs();
+    frameScheduler.wakeAtMs = 0.0;
+}
+
+// Fim de renderScene (depois da troca de buffers): mede a taxa e, nos modos contínuos,
+// agenda o próximo quadro. No modo sob demanda só há próximo quadro se alguém pediu.
+void Frame_End(void) {
+    double now = frameNowMs();
+    if (frameScheduler.windowFrames == 0) frameScheduler.windowStartMs = frameScheduler.frameStartMs;
+    frameScheduler.windowFrames++;
+    double elapsed = now - frameScheduler.windowStartMs;
+    if (elapsed >= 500.0) {
+        frameScheduler.rate = (float)(frameScheduler.windowFrames * 1000.0 / elapsed);
+        frameScheduler.windowFrames = 0;
+    }
+    if (frameMode != FRAME_ON_DEMAND) Frame_RequestRedraw();
+}
+
+void Frame_CycleMode(void) {
+    frameMode = (FrameMode)((frameMode + 1) % FRAME_MODE_COUNT);
+    frameScheduler.windowFrames = 0;
+    printf("Quadros: %s (limite %d por segundo)\n", Frame_ModeName(frameMode), frameRateCap);
+    Frame_RequestRedraw();
+}
+
+// ---- Modo headless (benchmark sem janela) ----
+// --headless[=n] não cria a janela do freeglut: abre um contexto GL de compatibilidade
+// em um pbuffer EGL (em servidor sem display, o Mesa pela plataforma surfaceless com o
+// rasterizador em software), monta a cena com o mesmo initGame do jogo (sala, MEN.obj,
+// slots, texturas) e chama renderScene n vezes com a câmera dando uma volta a partir da
+// posição inicial. Cada quadro termina em glFinish, então o tempo inclui a rasterização.
+// Sem glutInit não há fontes do GLUT e o texto do HUD fica de fora (os painéis não).
+// Só existe compilando com -DWITH_HEADLESS (e -lEGL).
+
+#ifdef WITH_HEADLESS
+
+#define HEADLESS_WARMUP_MS 120000.0   // limite para a carga terminar antes de medir
+
+static struct {
+    EGLDisplay display;
+    EGLSurface surface;
+    EGLContext context;
+} headless = { EGL_NO_DISPLAY, EGL_NO_SURFACE, EGL_NO_CONTEXT };
+
+static void headlessDestroyContext(void) {
+    if (headless.display == EGL_NO_DISPLAY) return;
+    eglMakeCurrent(headless.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (headless.context != EGL_NO_CONTEXT) eglDestroyContext(headless.display, headless.context);
+    if (headless.surface != EGL_NO_SURFACE) eglDestroySurface(headless.display, headless.surface);
+    eglTerminate(headless.display);
+    headless.display = EGL_NO_DISPLAY;
+    headless.surface = EGL_NO_SURFACE;
+    headless.context = EGL_NO_CONTEXT;
+}
+
+static int headlessCreateContext(int width, int height) {
+    // Mesa sem X/Wayland: plataforma surfaceless; senão o display padrão do EGL
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) headless.display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+#endif
+    if (headless.display == EGL_NO_DISPLAY) headless.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major = 0, minor = 0;
+    if (headless.display == EGL_NO_DISPLAY || !eglInitialize(headless.display, &major, &minor)) {
+        fprintf(stderr, "Headless: falha ao abrir o display EGL\n");
+        headless.display = EGL_NO_DISPLAY;
+        return 0;
+    }
+
+    // Mesmo formato da janela (GLUT_RGB | GLUT_DEPTH)
+    static const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(headless.display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+        fprintf(stderr, "Headless: nenhuma configuração EGL com OpenGL e pbuffer\n");
+        return 0;
+    }
+    const EGLint surfaceAttribs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+    headless.surface = eglCreatePbufferSurface(headless.display, config, surfaceAttribs);
+    if (headless.surface == EGL_NO_SURFACE) {
+        fprintf(stderr, "Headless: falha ao criar o pbuffer %dx%d\n", width, height);
+        return 0;
+    }
+    // Sem atributos a API OpenGL dá o perfil de compatibilidade, como a janela do GLUT
+    eglBindAPI(EGL_OPENGL_API);
+    headless.context = eglCreateContext(headless.display, config, EGL_NO_CONTEXT, NULL);
+    if (headless.context == EGL_NO_CONTEXT
+        || !eglMakeCurrent(headless.display, headless.surface, headless.surface, headless.context)) {
+        fprintf(stderr, "Headless: falha ao criar o contexto OpenGL\n");
+        return 0;
+    }
+    printf("EGL %d.%d: pbuffer %dx%d\n", major, minor, width, height);
+    return 1;
+}
+
+static int headlessCompareMs(const void* a, const void* b) {
+    double da = *(const double*)a, db = *(const double*)b;
+    return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+// Percentil pelo posto mais próximo (sorted em ordem crescente)
+static double headlessPercentile(const double* sorted, int count, double percent) {
+    int rank = (int)ceil(percent / 100.0 * count);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+int Headless_Run(const char* roomModelPath, int frames) {
+    if (!headlessCreateContext(screen_width, screen_height)) {
+        headlessDestroyContext();
+        return -1;
+    }
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        fprintf(stderr, "Falha ao inicializar o GLAD\n");
+        headlessDestroyContext();
+        return -1;
+    }
+    if (initGame(roomModelPath) != 0) {
+        headlessDestroyContext();
+        return -1;
+    }
+    reshape(screen_width, screen_height);
+    closeMenu(); // mede a sala, não o painel do menu
+
+    // Aquecimento: streaming dos modelos, texturas e PVS terminam antes de medir
+    uint64_t warmupStart = Clock_NowNs();
+    int warmupFrames = 0;
+    do {
+        renderScene();
+        warmupFrames++;
+    } while (sceneAnimating() && (Clock_NowNs() - warmupStart) / 1e6 < HEADLESS_WARMUP_MS);
+    printf("Headless: %d quadros de aquecimento em %.0f ms\n", warmupFrames, (Clock_NowNs() - warmupStart) / 1e6);
+
+    double* frameMs = (double*)malloc(frames * sizeof(double));
+    if (!frameMs) {
+        cleanup();
+        headlessDestroyContext();
+        return -1;
+    }
+    // Caminho da câmera: uma volta completa em yaw, com o pitch oscilando duas vezes em
+    // volta do inicial (chão e teto entram e saem do frustum)
+    float startYaw = cameraYaw, startPitch = cameraPitch;
+    double totalMs = 0.0;
+    for (int i = 0; i < frames; i++) {
+        float t = (float)i / frames;
+        cameraYaw = startYaw + 360.0f * t;
+        cameraPitch = glm_clamp(startPitch + 15.0f * sinf(4.0f * (float)GLM_PI * t), -89.0f, 89.0f);
+        uint64_t start = Clock_NowNs();
+        renderScene();
+        frameMs[i] = (Clock_NowNs() - start) / 1e6;
+        totalMs += frameMs[i];
+    }
+    cameraYaw = startYaw;
+    cameraPitch = startPitch;
+
+    qsort(frameMs, frames, sizeof(double), headlessCompareMs);
+    double meanMs = totalMs / frames;
+    printf("\nBenchmark headless: %d quadros %dx%d em %s (render %s, bonecos %s)\n", frames, screen_width, screen_height,
+           (const char*)glGetString(GL_RENDERER), RenderBackend_Name(RenderBackend_Effective()), Bonecos_PathName());
+    printf("  %8s %8s %8s %8s %8s %8s %8s\n", "média", "mín", "p50", "p90", "p95", "p99", "máx");
+    printf("  %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f  ms por quadro (%.1f por segundo)\n", meanMs, frameMs[0],
+           headlessPercentile(frameMs, frames, 50.0), headlessPercentile(frameMs, frames, 90.0),
+           headlessPercentile(frameMs, frames, 95.0), headlessPercentile(frameMs, frames, 99.0),
+           frameMs[frames - 1], meanMs > 0.0 ? 1000.0 / meanMs : 0.0);
+    free(frameMs);
+
+    cleanup();
+    headlessDestroyContext();
+    return 0;
+}
+
+#endif
+
+// ---- Perfil de quadro ----
+// Cada trecho de renderScene (atualização, sala, bonecos, martelo, HUD, troca de
+// buffers) fica entre Profiler_Begin e Profiler_End. O tempo de CPU é sempre medido
+// pelo relógio monotônico e guardado em um anel com os últimos PROFILER_HISTORY quadros;
+// a tecla H grava esse anel em CSV. Com o painel visível (tecla G) e GL 3.3, cada trecho
+// também ganha uma consulta GL_TIME_ELAPSED. Ela é lida PROFILER_GPU_LATENCY quadros
+// depois, e só se o resultado já saiu, para a CPU nunca esperar pela GPU. A troca de
+// buffers só tem tempo de CPU. O painel mostra a média dos últimos
+// PROFILER_AVERAGE_FRAMES quadros e o tempo de CPU de cada um dos últimos
+// PROFILER_GRAPH_FRAMES em um gráfico. No modo sob demanda só entram os quadros que
+// foram de fato desenhados.
+
+#define PROFILER_HISTORY 300
+#define PROFILER_AVERAGE_FRAMES 60
+#define PROFILER_GRAPH_FRAMES 120
+#define PROFILER_GPU_LATENCY 4
+#define PROFILER_GPU_UNKNOWN -1.0f
+#define PROFILER_GRAPH_SCALE_MS 33.3f    // altura do gráfico: dois quadros a 60 Hz
+
+typedef struct {
+    unsigned int frame;
+    float frameMs;                           // renderScene inteiro (CPU)
+    float cpuMs[PROFILE_SECTION_COUNT];
+    float gpuMs[PROFILE_SECTION_COUNT];      // PROFILER_GPU_UNKNOWN: não medido
+} ProfileFrame;
+
+// Consultas de um quadro em voo
+typedef struct {
+    GLuint queries[PROFILE_SECTION_COUNT];
+    int issued[PROFILE_SECTION_COUNT];
+    unsigned int frame;
+    int pending;
+} ProfileGpuFrame;
+
+static const struct {
+    const char* label;
+    const char* csvKey;
+} profileSections[PROFILE_SECTION_COUNT] = {
+    { "atualização", "atualizacao" },
+    { "sala", "sala" },
+    { "bonecos", "bonecos" },
+    { "martelo", "martelo" },
+    { "HUD e menus", "hud" },
+    { "troca de buffers", "troca" },
+};
+
+static struct {
+    ProfileFrame history[PROFILER_HISTORY];
+    unsigned int frameCount;                 // quadros concluídos
+    uint64_t frameStartNs;
+    uint64_t sectionStartNs[PROFILE_SECTION_COUNT];
+    ProfileGpuFrame gpu[PROFILER_GPU_LATENCY];
+    ProfileGpuFrame* gpuCurrent;             // NULL: sem consultas neste quadro
+    int gpuCreated;
+} profiler;
+
+int profilerVisible = 0; // tecla G
+
+static ProfileFrame* profilerFrame(unsigned int frame) {
+    return &profiler.history[frame % PROFILER_HISTORY];
+}
+
+// Lê as consultas de um quadro antigo se todas já tiverem resultado
+static void profilerCollectGpu(ProfileGpuFrame* gpu) {
+    for (int s = 0; s < PROFILE_SECTION_COUNT; s++) {
+        if (!gpu->issued[s]) continue;
+        GLint available = 0;
+        glGetQueryObjectiv(gpu->queries[s], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return; // ainda em voo: o quadro fica sem GPU
+    }
+    gpu->pending = 0;
+    if (profiler.frameCount - gpu->frame >= PROFILER_HISTORY) return; // já saiu do anel
+    ProfileFrame* entry = profilerFrame(gpu->frame);
+    for (int s = 0; s < PROFILE_SECTION_COUNT; s++) {
+        if (!gpu->issued[s]) continue;
+        GLuint64 elapsedNs = 0;
+        glGetQueryObjectui64v(gpu->queries[s], GL_QUERY_RESULT, &elapsedNs);
+        entry->gpuMs[s] = (float)(elapsedNs / 1e6);
+    }
+}
+
+void Profiler_BeginFrame(void) {
+    ProfileFrame* entry = profilerFrame(profiler.frameCount);
+    entry->frame = profiler.frameCount;
+    entry->frameMs = 0.0f;
+    for (int s = 0; s < PROFILE_SECTION_COUNT; s++) {
+        entry->cpuMs[s] = 0.0f;
+        entry->gpuMs[s] = PROFILER_GPU_UNKNOWN;
+    }
+    profiler.frameStartNs = Clock_NowNs();
+
+    profiler.gpuCurrent = NULL;
+    if (!profilerVisible || !GLAD_GL_VERSION_3_3) return;
+    if (!profiler.gpuCreated) {
+        for (int i = 0; i < PROFILER_GPU_LATENCY; i++) glGenQueries(PROFILE_SECTION_COUNT, profiler.gpu[i].queries);
+        profiler.gpuCreated = 1;
+    }
+    ProfileGpuFrame* gpu = &profiler.gpu[profiler.frameCount % PROFILER_GPU_LATENCY];
+    if (gpu->pending) profilerCollectGpu(gpu);
+    if (gpu->pending) return; // a GPU está mais de PROFILER_GPU_LATENCY quadros atrás
+    memset(gpu->issued, 0, sizeof(gpu->issued));
+    gpu->frame = profiler.frameCount;
+    gpu->pending = 1;
+    profiler.gpuCurrent = gpu;
+}
+
+void Profiler_EndFrame(void) {
+    profilerFrame(profiler.frameCount)->frameMs = (float)((Clock_NowNs() - profiler.frameStartNs) / 1e6);
+    profiler.frameCount++;
+}
+
+// Os trechos não se sobrepõem: uma consulta GL_TIME_ELAPSED ativa por vez
+void Profiler_Begin(ProfileSection section) {
+    profiler.sectionStartNs[section] = Clock_NowNs();
+    ProfileGpuFrame* gpu = profiler.gpuCurrent;
+    if (gpu && section != PROFILE_SWAP) {
+        glBeginQuery(GL_TIME_ELAPSED, gpu->queries[section]);
+        gpu->issued[section] = 1;
+    }
+}
+
+void Profiler_End(ProfileSection section) {
+    profilerFrame(profiler.frameCount)->cpuMs[section] += (float)((Clock_NowNs() - profiler.sectionStartNs[section]) / 1e6);
+    ProfileGpuFrame* gpu = profiler.gpuCurrent;
+    if (gpu && gpu->issued[section] && section != PROFILE_SWAP) glEndQuery(GL_TIME_ELAPSED);
+}
+
+// Painel no canto superior direito; chamado com a projeção de tela do HUD
+void Profiler_Draw(void) {
+    const int panelW = 3 * PROFILER_GRAPH_FRAMES, graphH = 60, lineH = 16;
+    const int panelH = graphH + (PROFILE_SECTION_COUNT + 3) * lineH + 20;
+    int x0 = screen_width - panelW - 10, y1 = screen_height - 10, y0 = y1 - panelH;
+
+    // Médias dos últimos quadros concluídos (GPU só dos que têm resultado)
+    unsigned int count = profiler.frameCount < PROFILER_AVERAGE_FRAMES ? profiler.frameCount : PROFILER_AVERAGE_FRAMES;
+    float cpuAvg[PROFILE_SECTION_COUNT] = { 0 }, gpuAvg[PROFILE_SECTION_COUNT] = { 0 };
+    int gpuCount[PROFILE_SECTION_COUNT] = { 0 };
+    float frameAvg = 0.0f, frameWorst = 0.0f;
+    for (unsigned int i = 0; i < count; i++) {
+        const ProfileFrame* entry = profilerFrame(profiler.frameCount - 1 - i);
+        frameAvg += entry->frameMs;
+        frameWorst = glm_max(frameWorst, entry->frameMs);
+        for (int s = 0; s < PROFILE_SECTION_COUNT; s++) {
+            cpuAvg[s] += entry->cpuMs[s];
+            if (entry->gpuMs[s] != PROFILER_GPU_UNKNOWN) {
+                gpuAvg[s] += entry->gpuMs[s];
+                gpuCount[s]++;
+            }
+        }
+    }
+
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glColor4f(0.0f, 0.0f, 0.0f, 0.75f);
+    overlayQuad(x0 - 8, y0, x0 + panelW + 8, y1);
+
+    // Gráfico: uma barra por quadro, o mais recente à direita; linha de referência em 16,7 ms
+    int graphY = y0 + 8;
+    glBegin(GL_QUADS);
+    for (unsigned int i = 0; i < PROFILER_GRAPH_FRAMES && i < profiler.frameCount; i++) {
+        float ms = profilerFrame(profiler.frameCount - 1 - i)->frameMs;
+        if (ms <= 1000.0f / 60.0f) glColor3f(0.3f, 0.85f, 0.3f);
+        else if (ms <= PROFILER_GRAPH_SCALE_MS) glColor3f(0.95f, 0.8f, 0.2f);
+        else glColor3f(0.95f, 0.3f, 0.25f);
+        int x = x0 + panelW - 3 * (int)(i + 1);
+        int top = graphY + (int)(glm_min(ms / PROFILER_GRAPH_SCALE_MS, 1.0f) * graphH);
+        if (top == graphY) top++;
+        glVertex2i(x, graphY);
+        glVertex2i(x + 2, graphY);
+        glVertex2i(x + 2, top);
+        glVertex2i(x, top);
+    }
+    glEnd();
+    glColor4f(1.0f, 1.0f, 1.0f, 0.5f);
+    int refY = graphY + (int)(1000.0f / 60.0f / PROFILER_GRAPH_SCALE_MS * graphH);
+    glBegin(GL_LINES);
+        glVertex2i(x0, refY);
+        glVertex2i(x0 + panelW, refY);
+    glEnd();
+    glPopAttrib();
+
+    static const float titleColor[3] = { 1.0f, 0.95f, 0.3f };
+    static const float rowColor[3] = { 0.9f, 0.9f, 0.9f };
+    int cpuX = x0 + 180, gpuX = x0 + 270;
+    int y = y1 - lineH;
+    char line[96];
+    snprintf(line, sizeof(line), "Perfil: média de %u quadros, pior %.1f ms", count, frameWorst);
+    Text_Draw(TEXT_FONT_SMALL, x0, y, titleColor, line);
+    y -= lineH;
+    Text_Draw(TEXT_FONT_SMALL, cpuX, y, titleColor, "CPU ms");
+    Text_Draw(TEXT_FONT_SMALL, gpuX, y, titleColor, GLAD_GL_VERSION_3_3 ? "GPU ms" : "GPU: sem GL 3.3");
+    float gpuTotal = 0.0f;
+    int gpuAny = 0;
+    for (int s = 0; s < PROFILE_SECTION_COUNT; s++) {
+        y -= lineH;
+        Text_Draw(TEXT_FONT_SMALL, x0, y, rowColor, profileSections[s].label);
+        snprintf(line, sizeof(line), "%.2f", count ? cpuAvg[s] / count : 0.0f);
+        Text_Draw(TEXT_FONT_SMALL, cpuX, y, rowColor, line);
+        if (gpuCount[s] > 0) {
+            gpuTotal += gpuAvg[s] / gpuCount[s];
+            gpuAny = 1;
+            snprintf(line, sizeof(line), "%.2f", gpuAvg[s] / gpuCount[s]);
+            Text_Draw(TEXT_FONT_SMALL, gpuX, y, rowColor, line);
+        }
+    }
+    y -= lineH;
+    Text_Draw(TEXT_FONT_SMALL, x0, y, titleColor, "quadro");
+    snprintf(line, sizeof(line), "%.2f", count ? frameAvg / count : 0.0f);
+    Text_Draw(TEXT_FONT_SMALL, cpuX, y, titleColor, line);
+    if (gpuAny) {
+        snprintf(line, sizeof(line), "%.2f", gpuTotal);
+        Text_Draw(TEXT_FONT_SMALL, gpuX, y, titleColor, line);
+    }
+    Text_Flush();
+}
+
+// Grava o anel (do quadro mais antigo ao mais recente) em perfil-quadros-<data>.csv
+void Profiler_DumpCsv(void) {
+    time_t now = time(NULL);
+    struct tm tmnow;
+    localtime_s(&tmnow, &now);
+    char path[64];
+    strftime(path, sizeof(path), "perfil-quadros-%Y%m%d-%H%M%S.csv", &tmnow);
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Falha ao gravar %s\n", path);
+        return;
+    }
+    fprintf(f, "quadro,total_cpu_ms");
+    for (int s = 0; s < PROFILE_SECTION_COUNT; s++) fprintf(f, ",%s_cpu_ms", profileSections[s].csvKey);
+    for (int s = 0; s < PROFILE_SECTION_COUNT; s++) fprintf(f, ",%s_gpu_ms", profileSections[s].csvKey);
+    fprintf(f, "\n");
+
+    unsigned int count = profiler.frameCount < PROFILER_HISTORY ? profiler.frameCount : PROFILER_HISTORY;
+    for (unsigned int frame = profiler.frameCount - count; frame < profiler.frameCount; frame++) {
+        const ProfileFrame* entry = profilerFrame(frame);
+        fprintf(f, "%u,%.3f", entry->frame, entry->frameMs);
+        for (int s = 0; s < PROFILE_SECTION_COUNT; s++) fprintf(f, ",%.3f", entry->cpuMs[s]);
+        for (int s = 0; s < PROFILE_SECTION_COUNT; s++) {
+            if (entry->gpuMs[s] == PROFILER_GPU_UNKNOWN) fprintf(f, ",");
+            else fprintf(f, ",%.3f", entry->gpuMs[s]);
+        }
+        fprintf(f, "\n");
+    }
+    fclose(f);
+    printf("Perfil: %u quadros gravados em %s\n", count, path);
+}
+
+void Profiler_Shutdown(void) {
+    if (profiler.gpuCreated) {
+        for (int i = 0; i < PROFILER_GPU_LATENCY; i++) glDeleteQueries(PROFILE_SECTION_COUNT, profiler.gpu[i].queries);
+    }
+    memset(&profiler, 0, sizeof(profiler));
+}